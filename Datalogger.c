@@ -5,8 +5,8 @@
 Projeto feito por Raphael Nascimento para a disciplina de EA076 - Sistemas Embarcados, como PAD para o 1S2023
 
 O programa simula um datalogger, medindo temperaturas a cada 2 segundos e salvando-as em uma memória EEPROM do tipo 24C16, com
-capacidade para 2048 palavras de 8 bits, que são utilizadas aos pares, sendo os primeiros 1023 pares ocupados por medidas de
-temperatura e o último par guardará a quantidade de medidas feitas.
+capacidade para 2048 palavras de 8 bits, que são utilizadas aos pares, sendo os pares a partir do endereço 0 ocupados por
+medidas de temperatura e o par 0x3FE guardará a quantidade de medidas feitas (ver Placa.h).
 A aquisição da temperatura será feita através do LM35 e lida analogicamente através da porta A0 do microcontrolador, sendo que a
 cada 10 mV lido representa 1ºC.
 A todo momento, a ultima medição feita será exibida no conjunto de display de 7 segmentos, onde seus segmentos estão conectados
@@ -75,43 +75,60 @@ As conexões feitas nesse programa foram:
 						   A1    A2    A3
 ********************************************************************************************************************************/
 
+#include <util/atomic.h>
 #include <Wire.h>
 #include <LiquidCrystal.h>
 
+#include "Placa.h"
+
+
+/********************************************************************************************************************************
+Para sobrar mais memória RAM (2 KB) as variáveis foram compactadas: as flags e os estados das máquinas ocupam juntos um único
+byte, em campos de bits da variavel 'estado', e os dígitos dos displays de 7 segmentos ocupam meio byte cada.
+As mensagens do LCD ficam somente na memória de programa, com a macro F(), e as tabelas constantes com PROGMEM.
+O consumo de RAM pode ser conferido com ferramentas/orcamento_memoria.py
+********************************************************************************************************************************/
 
 //Variaveis relacionadas a medição de temperatura
-float temperatura;
-int contadorTemperatura;
-unsigned char coletando;
+//Alterada pela interrupção do temporizador; como tem 16 bits, fora dela só é acessada dentro de ATOMIC_BLOCK
+volatile uint16_t contadorTemperatura;
 
 //Variaveis relacionadas aos displays de 7 segmentos
-unsigned char dezenaTemperatura;
-unsigned char unidadeTemperatura;
-unsigned char decimalTemperatura;
-unsigned char centesimalTemperatura;
-enum displays {dezena, unidade, decimal, centesimal} digitos;
+struct {
+	unsigned char dezena : 4;
+	unsigned char unidade : 4;
+	unsigned char decimal : 4;
+	unsigned char centesimal : 4;
+} digitosTemperatura;
+enum displays {dezena, unidade, decimal, centesimal};
 
 //Variaveis relacionadas ao uso da EEPROM
-#define endEEPROM 0x50
-int quantOcupada;
+int16_t quantOcupada;
 
 //Variaveis relacionadas a execução das funções
-enum funcoes {semFuncao, reset, status, start, stop, transferir, escolherValores, enviarValores} funcao;
+enum funcoes {semFuncao, reset, status, start, stop, transferir, escolherValores, enviarValores};
 
 //Variaveis relacionadas a impressão dos valores pela serial
 int digitosImpressao;
 int impressao;
 
 //Variaveis relacionadas ao teclado
-char teclado [4][3] = {
+const char teclado [4][3] PROGMEM = {
   '1', '2', '3',
   '4', '5', '6',
   '7', '8', '9', 
   '*', '0', '#'
 };
-char teclaReconhecida;
 char tecla;
 
+//Flags e estados, compactados em um byte
+struct {
+	unsigned char coletando : 1;
+	unsigned char teclaReconhecida : 1;
+	unsigned char digitos : 2;		//displays
+	unsigned char funcao : 3;		//funcoes
+} estado;
+
 //Variaveis relacionadas ao display LCD
 LiquidCrystal lcd_1(13, 12, 8, 9, 10, 11);
 
@@ -126,7 +143,7 @@ void escreverEEPROM(int dado, int posicao){
 	
 	O endereço da memória 24C16 possui 11 bits, portanto será separado em dois bytes, onde o byte mais significativo irá conter
 	somente 3 bits, que serão concatenados com o endereço do CI e o byte menos significativo será enviado em seguida em uma
-	operação de escrita.
+	operação de escrita. A concatenação é feita por Placa::Memoria::dispositivo, de acordo com o tamanho da memória da placa.
 	
 	O dado a ser enviado também é dividido em dois bytes, que serão enviados logo em seguida
 	
@@ -134,14 +151,13 @@ void escreverEEPROM(int dado, int posicao){
 	próxima operação de escrita
 	****************************************************************************************************************************/
 	
-	unsigned char endMSB = posicao >> 8;
 	unsigned char endLSB = posicao & 0xFF;
 	
 	unsigned char dadoMSB = dado >> 8;
 	unsigned char dadoLSB = dado & 0xFF;
 	
 	
-	Wire.beginTransmission(endEEPROM | endMSB);
+	Wire.beginTransmission(Placa::Memoria::dispositivo(posicao));
 	Wire.write (endLSB);
 	
 	Wire.write (dadoMSB);
@@ -152,7 +168,7 @@ void escreverEEPROM(int dado, int posicao){
 	_delay_ms(5);
 }
 
-int lerEEPROM(int posicao){
+int16_t lerEEPROM(int posicao){
 	/****************************************************************************************************************************
 	Esta função serve para ler dois bytes consecutivos da memória e concatena-los em uma única variável
 	
@@ -163,19 +179,18 @@ int lerEEPROM(int posicao){
 	
 	
 	
-	int leitura = 0xFFFF;
+	int16_t leitura = 0xFFFF;
 	
 	
-	unsigned char endMSB = posicao >> 8;
 	unsigned char endLSB = posicao & 0xFF;
 	
 	
-	Wire.beginTransmission(endEEPROM | endMSB);
+	Wire.beginTransmission(Placa::Memoria::dispositivo(posicao));
 	Wire.write (endLSB);
 	
 	Wire.endTransmission();
 	
-	Wire.requestFrom((endEEPROM | endMSB), 2);
+	Wire.requestFrom((int) Placa::Memoria::dispositivo(posicao), 2);
 	
 	leitura = Wire.read() << 8;
 	leitura |= Wire.read();
@@ -194,24 +209,24 @@ void mostrarDigitos(){
 	corresponde ao valor que é enviado ao CD4511
 	****************************************************************************************************************************/
 	
-	Wire.beginTransmission(0x20);
-	switch (digitos){
+	Wire.beginTransmission(Placa::enderecoExpansor);
+	switch (estado.digitos){
 		default:
 		case dezena:
-			Wire.write(dezenaTemperatura | (0x07 << 4));
-			digitos = unidade;
+			Wire.write(digitosTemperatura.dezena | (0x07 << 4));
+			estado.digitos = unidade;
 			break;
 		case unidade:
-			Wire.write(unidadeTemperatura | (0x0B << 4));
-			digitos = decimal;
+			Wire.write(digitosTemperatura.unidade | (0x0B << 4));
+			estado.digitos = decimal;
 			break;
 		case decimal:
-			Wire.write(decimalTemperatura | (0x0D << 4));
-			digitos = centesimal;
+			Wire.write(digitosTemperatura.decimal | (0x0D << 4));
+			estado.digitos = centesimal;
 			break;
 		case centesimal:
-			Wire.write(centesimalTemperatura | (0x0E << 4));
-			digitos = dezena;
+			Wire.write(digitosTemperatura.centesimal | (0x0E << 4));
+			estado.digitos = dezena;
 			break;
 		
 	}
@@ -221,31 +236,45 @@ void mostrarDigitos(){
 
 
 //FUNÇÕES DO TECLADO MATRICIAL
+template <uint8_t LINHA>
+inline uint8_t lerLinhaTeclado(){
+	/****************************************************************************************************************************
+	Coloca somente a linha LINHA em nível baixo e retorna as colunas que estão em nível baixo, a primeira coluna no bit 0
+	Como os pinos e máscaras são constantes da placa, cada chamada se resume a uma escrita em PORTD e uma leitura de PINC
+	O 'nop' dá tempo para o sincronizador da porta de entrada capturar o novo nível das colunas
+	****************************************************************************************************************************/
+	PORTD = (PORTD | Placa::Teclado::mascaraLinhas) & ~Placa::Teclado::linha(LINHA);
+	__asm__ __volatile__ ("nop");
+	
+	return (~PINC & Placa::Teclado::mascaraColunas) >> Placa::Teclado::primeiraColuna;
+}
+
 char varreduraTeclado(){
 	/****************************************************************************************************************************
 	A função serve para identificar se alguma tecla está sendo pressionada, por meio de varredura
-	As linhas estão conectadas em portas definidas como saída, sendo que em cada loop somente uma delas será colocada em nível
-	baixo, enquanto que a restante continua em nível alto
+	As linhas estão conectadas em portas definidas como saída, sendo que somente uma delas é colocada em nível baixo por vez,
+	enquanto que a restante continua em nível alto
 	As colunas estão conectadas em portas definidas como entrada, com o resistor de pull-up ativo
 	Deste modo, quando uma tecla é pressionada, se sua linha estiver em nível baixo o valor baixo aparecerá na coluna
-	correspondente, que será lido pelo loop aninhado.
-	Quando a primeira tecla pressionada for encontrada, o caractere existente na tecla, que foi definido na variavel 'teclado'
-	será retornado pela função, que encerrará sua execução.
+	correspondente.
+	As quatro linhas são lidas sempre, sem laços, e a tecla é escolhida com a tabela 'primeiroBit', que indica o bit menos
+	significativo ligado em cada valor de 4 bits. A prioridade é a mesma da varredura por laços: primeiro a linha de cima e,
+	dentro dela, a coluna da esquerda. O caractere retornado é o definido na variavel 'teclado'
 	Caso nenhuma tecla esteja pressionada, o valor de '-1' será enviado
 	****************************************************************************************************************************/
 	
-	for (char linhas = 2; linhas <= 5; linhas++){
-		PORTD |= 0x3C;
-		PORTD &= ~(1 << linhas);
-		
-		for (char colunas = 1; colunas <= 3; colunas++){
-			if (((PINC & 0x0E) & (1 << colunas)) == 0) {
-				return teclado[linhas-2][colunas-1];
-			}
-		}
+	static const uint8_t primeiroBit[16] PROGMEM = {0, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0};
+	
+	uint8_t colunas[4] = {lerLinhaTeclado<0>(), lerLinhaTeclado<1>(), lerLinhaTeclado<2>(), lerLinhaTeclado<3>()};
+	uint8_t linhas = (colunas[0] != 0) | (colunas[1] != 0) << 1 | (colunas[2] != 0) << 2 | (colunas[3] != 0) << 3;
+	
+	if (linhas == 0){
+		return -1;
 	}
 	
-	return -1;
+	uint8_t linha = pgm_read_byte(&primeiroBit[linhas]);
+	uint8_t coluna = pgm_read_byte(&primeiroBit[colunas[linha]]);
+	return pgm_read_byte(&teclado[linha][coluna]);
 }
 
 void verificarTeclado(){
@@ -261,10 +290,10 @@ void verificarTeclado(){
 	char teclaAtual = varreduraTeclado();
 	
 	
-	if (teclaAtual != -1 && teclaReconhecida == 0){
-		teclaReconhecida = 1;
+	if (teclaAtual != -1 && estado.teclaReconhecida == 0){
+		estado.teclaReconhecida = 1;
 		tecla = teclaAtual;
-		if (funcao == escolherValores){
+		if (estado.funcao == escolherValores){
 			if (digitosImpressao < 4 && tecla != '#'){
 				lcd_1.print(tecla);
 				impressao = impressao*10 + int(tecla) - 48;
@@ -273,7 +302,7 @@ void verificarTeclado(){
 		}
 	}
 	else if (teclaAtual == -1){
-		teclaReconhecida = 0;
+		estado.teclaReconhecida = 0;
     }
 }
 
@@ -287,59 +316,59 @@ manualmente, para esperar o usuário digitar a quantidade desejada
 ********************************************************************************************************************************/
 void funcaoReset(){
 	lcd_1.clear();
-	lcd_1.print("Apagar Memoria?");
+	lcd_1.print(F("Apagar Memoria?"));
 	lcd_1.setCursor(0, 1);
-	lcd_1.print("*/# - Nao/Sim");
+	lcd_1.print(F("*/# - Nao/Sim"));
 	
-	funcao = reset;
+	estado.funcao = reset;
 }
 
 void funcaoStatus(){
 	lcd_1.clear();
-	lcd_1.print("Mostrar Status?");
+	lcd_1.print(F("Mostrar Status?"));
 	lcd_1.setCursor(0, 1);
-	lcd_1.print("*/# - Nao/Sim");
+	lcd_1.print(F("*/# - Nao/Sim"));
 	
-	funcao = status;
+	estado.funcao = status;
 }
 
 void funcaoStart(){
 	lcd_1.clear();
-	lcd_1.print("Iniciar coleta?");
+	lcd_1.print(F("Iniciar coleta?"));
 	lcd_1.setCursor(0, 1);
-	lcd_1.print("*/# - Nao/Sim");
+	lcd_1.print(F("*/# - Nao/Sim"));
 	
-	funcao = start;
+	estado.funcao = start;
 }
 
 void funcaoStop(){
 	lcd_1.clear();
-	lcd_1.print("Terminar coleta?");
+	lcd_1.print(F("Terminar coleta?"));
 	lcd_1.setCursor(0, 1);
-	lcd_1.print("*/# - Nao/Sim");
+	lcd_1.print(F("*/# - Nao/Sim"));
 	
-	funcao = stop;
+	estado.funcao = stop;
 }
 
 void funcaoTransf(){
 	lcd_1.clear();
-	lcd_1.print("Transf. dados?");
+	lcd_1.print(F("Transf. dados?"));
 	lcd_1.setCursor(0, 1);
-	lcd_1.print("*/# - Nao/Sim");
+	lcd_1.print(F("*/# - Nao/Sim"));
 	
-	funcao = transferir;
+	estado.funcao = transferir;
 	tecla = -1;
 }
 
 void cancela(){
 	lcd_1.clear();
-	lcd_1.print("Cancelado!");
+	lcd_1.print(F("Cancelado!"));
 	lcd_1.setCursor(0, 1);
-	lcd_1.print("Escolha a funcao");
+	lcd_1.print(F("Escolha a funcao"));
 	
 	digitosImpressao = 0;
 	impressao = 0;
-	funcao = semFuncao;
+	estado.funcao = semFuncao;
 }
 
 
@@ -351,7 +380,7 @@ void funcaoImprimir(){
 	Ao final da impressão os valores são zerados para serem utilizados novamente em outra impressão, quando houver necessidade
 	****************************************************************************************************************************/
 	if (digitosImpressao < impressao){
-		float temp = lerEEPROM(digitosImpressao << 1);
+		float temp = lerEEPROM(Placa::Memoria::enderecoMedida(digitosImpressao));
 		Serial.println(temp/100);
 		
 		digitosImpressao++;
@@ -361,7 +390,7 @@ void funcaoImprimir(){
 	
 	digitosImpressao = 0;
 	impressao = 0;
-	funcao = semFuncao;
+	estado.funcao = semFuncao;
 }
 
 void confirma(){
@@ -385,69 +414,70 @@ void confirma(){
 	ultrapasse a quantidade gravada
 	Durante a transmissão é deixada a variável 'funcao' em 7 para não aceitar outros comandos
 	****************************************************************************************************************************/
-	switch (funcao){
+	switch (estado.funcao){
 		case 1:
-			escreverEEPROM(0x0000, 0x3FE);
+			escreverEEPROM(0x0000, Placa::Memoria::enderecoQuantidade);
 			quantOcupada = 0;
 			
 			lcd_1.clear();
-			lcd_1.print("Memoria Apagada!");
+			lcd_1.print(F("Memoria Apagada!"));
 			lcd_1.setCursor(0, 1);
-			lcd_1.print("Disponivel: 1023");
+			lcd_1.print(F("Disponivel: "));
+			lcd_1.print(Placa::Memoria::capacidade);
 			
-			funcao = semFuncao;
+			estado.funcao = semFuncao;
 			break;
 		
 		case 2:
 			lcd_1.clear();
-			lcd_1.print("Gravado:    ");
+			lcd_1.print(F("Gravado:    "));
 			lcd_1.print(quantOcupada);
 			lcd_1.setCursor(0, 1);
-			lcd_1.print("Disponivel: ");
-			lcd_1.print(1023 - quantOcupada);
+			lcd_1.print(F("Disponivel: "));
+			lcd_1.print(Placa::Memoria::capacidade - quantOcupada);
 			
-			funcao = semFuncao;
+			estado.funcao = semFuncao;
 			break;
 		
 		case 3:
-			if (quantOcupada >= 1023) {
+			if (quantOcupada >= Placa::Memoria::capacidade) {
 				lcd_1.clear();
-				lcd_1.print("Memoria Cheia");
+				lcd_1.print(F("Memoria Cheia"));
 				lcd_1.setCursor(0, 1);
-				lcd_1.print("Limpe a Memoria");
+				lcd_1.print(F("Limpe a Memoria"));
 				
-				funcao = semFuncao;
+				estado.funcao = semFuncao;
 				break;
 			}
-			coletando = 1;
+			estado.coletando = 1;
 	
 			lcd_1.clear();
-			lcd_1.print("Coleta Iniciada!");
+			lcd_1.print(F("Coleta Iniciada!"));
 			lcd_1.setCursor(0, 1);
-			lcd_1.print("Gravando Memoria");
+			lcd_1.print(F("Gravando Memoria"));
 			
-			funcao = semFuncao;
+			estado.funcao = semFuncao;
 			break;
 			
 		case 4:
-			coletando = 0;
+			estado.coletando = 0;
 			
 			lcd_1.clear();
-			lcd_1.print("Fim da coleta!");
+			lcd_1.print(F("Fim da coleta!"));
 			lcd_1.setCursor(0, 1);
-			lcd_1.print("No DADOS: ");
+			lcd_1.print(F("No DADOS: "));
 			lcd_1.print(quantOcupada);
 			
-			funcao = semFuncao;
+			estado.funcao = semFuncao;
 			break;
 			
 		case 5:
 			lcd_1.clear();
-			lcd_1.print("Transf. dados:");
+			lcd_1.print(F("Transf. dados:"));
 			lcd_1.setCursor(0, 1);
-			lcd_1.print("Qntd dados: ");
+			lcd_1.print(F("Qntd dados: "));
 			
-			funcao = escolherValores;
+			estado.funcao = escolherValores;
 			tecla = -1;
 			break;
 		
@@ -456,19 +486,19 @@ void confirma(){
 				impressao = quantOcupada;
 				
 				lcd_1.clear();
-				lcd_1.print("Qnt > gravado");
+				lcd_1.print(F("Qnt > gravado"));
 				lcd_1.setCursor(0, 1);
-				lcd_1.print("Imprimindo: ");
+				lcd_1.print(F("Imprimindo: "));
 				lcd_1.print(impressao);
 			}
 			else {
 				lcd_1.clear();
-				lcd_1.print("Imprimindo: ");
+				lcd_1.print(F("Imprimindo: "));
 				lcd_1.print(impressao);
 			}
 			digitosImpressao = 0;
 			
-			funcao = enviarValores;
+			estado.funcao = enviarValores;
 			break;
 	}
 }
@@ -478,7 +508,7 @@ void realizarFuncao(){
 	Esta função serve somente para direcionar o programa dependendo da função escolhida pelo usuário, sendo que só é possivel
 	escolher uma função caso nehuma outra esteja em execução e só é possível confirmar ou cancelar durante uma função
 	****************************************************************************************************************************/
-	if (funcao == 0){
+	if (estado.funcao == 0){
 		switch (tecla){
 			case '1':
 				funcaoReset();
@@ -508,20 +538,19 @@ void realizarFuncao(){
 }
 
 
-void converterTemperatura(int temp){
+void converterTemperatura(uint16_t temp){
 	/****************************************************************************************************************************
 	Os quatro digitos do valor da temperatura são separados em variaveis separadas, para exibição no display de 7 segmentos
 	****************************************************************************************************************************/
 
-	dezenaTemperatura = temp/1000;
+	digitosTemperatura.dezena = temp/1000;
 	
-	temp -= 1000*dezenaTemperatura;
-	unidadeTemperatura = temp/100;
+	temp %= 1000;
+	digitosTemperatura.unidade = temp/100;
 	
-	temp -= 100*unidadeTemperatura;
-	decimalTemperatura = temp/10;
-	
-	centesimalTemperatura = temp%10;
+	temp %= 100;
+	digitosTemperatura.decimal = temp/10;
+	digitosTemperatura.centesimal = temp%10;
 }
 
 void medirTemperatura(){
@@ -539,23 +568,23 @@ void medirTemperatura(){
 	****************************************************************************************************************************/
 	
 	
-	temperatura = analogRead(A0) * 48.8759;
+	uint16_t temperatura = analogRead(A0) * 48.8759;
 	
 	converterTemperatura(temperatura);
 	
-	if (coletando){
-		escreverEEPROM(temperatura, quantOcupada << 1);
+	if (estado.coletando){
+		escreverEEPROM(temperatura, Placa::Memoria::enderecoMedida(quantOcupada));
 		quantOcupada++;
-		escreverEEPROM(quantOcupada, 0x3FE);
+		escreverEEPROM(quantOcupada, Placa::Memoria::enderecoQuantidade);
 		
-		if (quantOcupada >= 1023){
+		if (quantOcupada >= Placa::Memoria::capacidade){
 			lcd_1.clear();
-			lcd_1.print("Memoria Cheia");
+			lcd_1.print(F("Memoria Cheia"));
 			lcd_1.setCursor(0, 1);
-			lcd_1.print("Coleta Terminada");
+			lcd_1.print(F("Coleta Terminada"));
 			
-			coletando = 0;
-			funcao = semFuncao;
+			estado.coletando = 0;
+			estado.funcao = semFuncao;
 		}
 	}
 }
@@ -575,49 +604,47 @@ ISR(TIMER0_COMPA_vect){
 //FUNÇÕES DE CONFIGURAÇÕES
 void setupGPIO(){
 	/****************************************************************************************************************************
-	As portas referentes ao teclado matricial são definidas como saída (A1, A2, A3) ou entrada com pull-up (2, 3, 4, 5)
+	As portas referentes ao teclado matricial são definidas como saída (A1, A2, A3) ou entrada com pull-up (2, 3, 4, 5) e a porta
+	do LM35 (A0) como entrada
 	As portas do display LCD não são alteradas aqui, pois são alteradas dentro da biblioteca LiquidCrystal
 	****************************************************************************************************************************/
-	DDRC &= 0xF0;
-	PORTC |= 0x0E;
+	DDRC &= ~(Placa::Teclado::mascaraColunas | Placa::mascaraSensor);
+	PORTC |= Placa::Teclado::mascaraColunas;
 
-	DDRD |= 0x3C;
+	DDRD |= Placa::Teclado::mascaraLinhas;
 }
 
 void setupInicial(){
 	
 	
 	//Variaveis relacionadas a medição de temperatura
-	temperatura = analogRead(A0) * 48.8759;
-	contadorTemperatura = 0;
-	coletando = 0;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		contadorTemperatura = 0;
+	}
+	estado.coletando = 0;
 
 	//Variaveis relacionadas aos displays de 7 segmentos
-	converterTemperatura(temperatura);
-		//dezenaTemperatura;
-		//unidadeTemperatura;
-		//decimalTemperatura;
-		//centesimalTemperatura;
-	digitos = 0;
+	converterTemperatura(analogRead(A0) * 48.8759);
+	estado.digitos = dezena;
 
 	//Variaveis relacionadas ao uso da EEPROM
-	quantOcupada = lerEEPROM(0x3FE);
+	quantOcupada = lerEEPROM(Placa::Memoria::enderecoQuantidade);
 
 	//Variaveis relacionadas a execução das funções
-	funcao = semFuncao;
+	estado.funcao = semFuncao;
 
 	//Variaveis relacionadas a impressão dos valores pela serial
 	digitosImpressao = 0;
 	impressao = 0;
 
 	//Variaveis relacionadas ao teclado
-	teclaReconhecida = 0;
+	estado.teclaReconhecida = 0;
 	tecla = -1;
 	
 	//Variaveis relacionadas ao display LCD
-	lcd_1.print("Bem Vindo!");
+	lcd_1.print(F("Bem Vindo!"));
 	lcd_1.setCursor(0, 1);
-	lcd_1.print("Escolha a funcao");
+	lcd_1.print(F("Escolha a funcao"));
 }
 
 
@@ -726,8 +753,21 @@ void setup() {
 
 //FUNÇÃO PRINCIPAL
 void loop () {
-	if (contadorTemperatura >= 500){
-		contadorTemperatura = 0;
+	/****************************************************************************************************************************
+	O teste e a zeragem do contador são feitos com as interrupções desabilitadas, pois a leitura de 16 bits leva duas instruções
+	e a interrupção poderia alterar o contador entre elas. A medição fica fora do bloco, pois a biblioteca Wire depende da
+	interrupção do TWI
+	****************************************************************************************************************************/
+	bool amostrar = false;
+	
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE){
+		if (contadorTemperatura >= Placa::interrupcoesAmostragem){
+			contadorTemperatura = 0;
+			amostrar = true;
+		}
+	}
+	
+	if (amostrar){
 		medirTemperatura();
 	}
 	
@@ -737,7 +777,7 @@ void loop () {
 	
 	realizarFuncao();
 	
-	if (funcao == enviarValores){
+	if (estado.funcao == enviarValores){
 		funcaoImprimir();		
 	}
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+/********************************************************************************************************************************
+Configuração das variantes de placa do Datalogger
+
+Todos os detalhes de hardware usados pelo firmware (memória EEPROM, endereço do expansor PCF8574, pinos do teclado matricial e
+período de amostragem) são parâmetros de template, resolvidos durante a compilação. Assim as máscaras, endereços e contagens
+aparecem no código como constantes, sem variáveis globais e sem testes em tempo de execução.
+
+A variante é escolhida definindo PLACA na compilação, por exemplo com o arduino-cli:
+	arduino-cli compile --build-property "compiler.cpp.extra_flags=-DPLACA=PlacaP3A" ...
+Sem essa definição é usada a placa original (PlacaP3).
+
+Limitações desta camada:
+	- As linhas do teclado devem estar em PORTD e as colunas em PINC, mas em quaisquer pinos consecutivos
+	- O temporizador 0 continua gerando uma interrupção a cada 4 ms, então o período de amostragem deve ser múltiplo de 4 ms
+	- Somente memórias 24C01 a 24C16, onde os bits mais significativos do endereço vão junto com o endereço do CI
+********************************************************************************************************************************/
+
+#ifndef PLACA_H
+#define PLACA_H
+
+#include <stdint.h>
+
+
+template <uint16_t TAMANHO, uint16_t ENDERECO_QUANTIDADE = TAMANHO - 2>
+struct Memoria24Cxx {
+	/****************************************************************************************************************************
+	As medidas ocupam pares de bytes a partir do endereço 0 e a quantidade de medidas feitas é guardada no par
+	ENDERECO_QUANTIDADE, que por padrão é o último par da memória. Todos os outros pares guardam medidas: quando o par da
+	quantidade fica no meio da memória, as medidas seguintes são gravadas a partir do par depois dele
+	****************************************************************************************************************************/
+	static_assert(TAMANHO >= 128 && TAMANHO <= 2048 && (TAMANHO & (TAMANHO - 1)) == 0, "memoria 24C01 a 24C16");
+	static_assert(ENDERECO_QUANTIDADE < TAMANHO && ENDERECO_QUANTIDADE % 2 == 0, "par da quantidade fora da memoria");
+
+	static constexpr uint8_t endereco = 0x50;
+	static constexpr uint16_t tamanho = TAMANHO;
+	static constexpr uint16_t enderecoQuantidade = ENDERECO_QUANTIDADE;
+	static constexpr int capacidade = TAMANHO / 2 - 1;
+
+	//Endereço do par da medida de índice 'n', pulando o par da quantidade
+	static constexpr uint16_t enderecoMedida(uint16_t n){
+		return (n << 1) < ENDERECO_QUANTIDADE ? n << 1 : (n + 1) << 1;
+	}
+
+	//Endereço do CI concatenado com os bits do endereço da palavra acima do oitavo
+	static constexpr uint8_t dispositivo(uint16_t posicao){
+		return endereco | ((posicao >> 8) & ((TAMANHO - 1) >> 8));
+	}
+};
+
+template <uint8_t PRIMEIRA_LINHA, uint8_t PRIMEIRA_COLUNA>
+struct Teclado4x3 {
+	/****************************************************************************************************************************
+	Linhas em 4 pinos consecutivos de PORTD, a partir de PRIMEIRA_LINHA, e colunas em 3 pinos consecutivos de PINC, a partir de
+	PRIMEIRA_COLUNA. Os demais pinos dessas portas já são usados: PD0/PD1 pela serial, PC0 (A0) pelo LM35 e PC4/PC5 pelo I2C,
+	então as linhas podem começar em PD2 a PD4 e as colunas somente em PC1
+	****************************************************************************************************************************/
+	static_assert(PRIMEIRA_LINHA >= 2 && PRIMEIRA_LINHA <= 4, "linhas do teclado sobre a serial ou fora da porta");
+	static_assert(PRIMEIRA_COLUNA == 1, "colunas do teclado sobre o LM35 ou o I2C");
+
+	static constexpr uint8_t primeiraLinha = PRIMEIRA_LINHA;
+	static constexpr uint8_t primeiraColuna = PRIMEIRA_COLUNA;
+	static constexpr uint8_t mascaraLinhas = 0x0F << PRIMEIRA_LINHA;
+	static constexpr uint8_t mascaraColunas = 0x07 << PRIMEIRA_COLUNA;
+
+	static constexpr uint8_t linha(uint8_t n){
+		return 1 << (PRIMEIRA_LINHA + n);
+	}
+
+	static constexpr uint8_t coluna(uint8_t n){
+		return 1 << (PRIMEIRA_COLUNA + n);
+	}
+};
+
+template <class MEMORIA, class TECLADO, uint8_t ENDERECO_EXPANSOR, uint16_t PERIODO_AMOSTRAGEM_MS>
+struct ConfiguracaoPlaca {
+	static_assert(PERIODO_AMOSTRAGEM_MS % 4 == 0, "periodo de amostragem deve ser multiplo de 4 ms");
+
+	typedef MEMORIA Memoria;
+	typedef TECLADO Teclado;
+
+	static constexpr uint8_t enderecoExpansor = ENDERECO_EXPANSOR;
+	static constexpr uint8_t mascaraSensor = 1 << 0;		//PC0 (A0), entrada do LM35 em todas as variantes
+	static constexpr uint16_t periodoAmostragem = PERIODO_AMOSTRAGEM_MS;
+
+	//Quantidade de interrupções do temporizador 0 (4 ms) entre duas medidas
+	static constexpr uint16_t interrupcoesAmostragem = PERIODO_AMOSTRAGEM_MS / 4;
+};
+
+
+//Placa original do projeto: 24C16, PCF8574, linhas em PD2 a PD5, colunas em PC1 a PC3 e uma medida a cada 2 s
+//A quantidade fica em 0x3FE, e não no último par da 24C16, para manter o formato das memórias já gravadas; as medidas a
+//partir da 511 pulam esse par. Nas memórias gravadas pela versão original a medida 511 foi sobrescrita pela quantidade
+typedef ConfiguracaoPlaca<Memoria24Cxx<2048, 0x3FE>, Teclado4x3<2, 1>, 0x20, 2000> PlacaP3;
+
+//Placa original montada com o PCF8574A, que responde a partir do endereço 0x38
+typedef ConfiguracaoPlaca<Memoria24Cxx<2048, 0x3FE>, Teclado4x3<2, 1>, 0x38, 2000> PlacaP3A;
+
+//Placa com a 24C08: metade das medidas, com o dobro do período para manter o mesmo tempo de coleta
+typedef ConfiguracaoPlaca<Memoria24Cxx<1024>, Teclado4x3<2, 1>, 0x20, 4000> PlacaP3Compacta;
+
+
+#ifndef PLACA
+#define PLACA PlacaP3
+#endif
+
+typedef PLACA Placa;
+
+#endif
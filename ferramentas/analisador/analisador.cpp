@@ -0,0 +1,484 @@
+/********************************************************************************************************************************
+Analisador de imagens da EEPROM do Datalogger
+
+Lê imagens brutas da memória (o conteúdo completo da 24Cxx, byte a byte), no formato gravado por escreverEEPROM: medidas em
+centésimos de grau, em pares de bytes com o mais significativo primeiro, a partir do endereço 0, e a quantidade de medidas no
+par reservado para ela. Para imagens do tamanho da memória da placa escolhida em Placa.h é usado o mesmo par do firmware (0x3FE
+na PlacaP3); para outros tamanhos, o último par da memória.
+
+Cada imagem é validada e resumida em uma linha com o mínimo, o máximo e a média das medidas, a quantidade de medidas fora da
+faixa válida e o histograma dessa faixa. Uma imagem é inválida quando o tamanho não é de uma 24Cxx, quando a quantidade está
+apagada (0xFFFF, memória nunca zerada pela função 1) ou quando a quantidade ultrapassa a capacidade da memória. Como no
+firmware (Placa::Memoria::enderecoMedida), as medidas depois do par da quantidade começam no par seguinte a ele; nas memórias
+gravadas pela versão original com mais de 511 medidas, a medida 511 se perdeu e o último par lido não é uma medida.
+
+Os arquivos são mapeados em memória (mmap) e distribuídos entre várias threads. Os laços de mínimo, máximo, soma e contagem
+fora da faixa não têm desvios, para que o compilador os vetorize; o histograma usa uma tabela com a classe de cada valor.
+
+Saídas:
+	CSV (padrão, na saída padrão), com o nome do arquivo entre aspas:
+		arquivo,situacao,tamanho,quantidade,minimo,maximo,media,fora_da_faixa,h0,...,hN
+	Colunar (--colunar), binário little-endian:
+		"DLCOLUNA", uint32 linhas, uint32 classes, float faixa mínima, float faixa máxima, seguidos das colunas, cada uma
+		com um valor por linha: uint8 situação (índice em nomeSituacao), uint32 tamanho, uint16 quantidade, float mínimo,
+		float máximo, float média, uint32 fora da faixa, uint32 por classe do histograma, uint32 fim de cada nome e, por
+		último, os nomes dos arquivos concatenados
+Um resumo de toda a frota e o tempo de processamento são impressos na saída de erros.
+
+Compilação (a partir da raiz do repositório):
+	g++ -std=c++11 -O3 -march=native -pthread ferramentas/analisador/analisador.cpp -o analisador
+Para imagens de outra variante de placa basta acrescentar, por exemplo, -DPLACA=PlacaP3Compacta.
+
+Uso:
+	./analisador [--csv <arquivo>] [--colunar <arquivo>] [--min <°C>] [--max <°C>] [--classes <n>] [--tarefas <n>]
+		<imagem ou diretório>...
+********************************************************************************************************************************/
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../Placa.h"
+
+
+#define TAMANHO_MINIMO		128			//24C01
+#define TAMANHO_MAXIMO		65536		//24C512
+#define MAXIMO_CLASSES		254
+#define FORA_DA_FAIXA		255			//classe dos valores fora da faixa na tabela do histograma
+
+enum situacoes {ok, tamanhoInvalido, nuncaApagada, quantidadeInvalida, erroLeitura};
+static const char *nomeSituacao[] = {"ok", "invalido:tamanho", "invalido:apagada", "invalido:quantidade", "erro:leitura"};
+
+struct Resultado {
+	std::string arquivo;
+	uint8_t situacao;
+	uint32_t tamanho;
+	uint16_t quantidade;
+	uint16_t minimo;
+	uint16_t maximo;
+	uint32_t soma;
+	uint32_t fora;
+	std::vector<uint32_t> histograma;
+};
+
+struct Opcoes {
+	uint16_t faixaMinima;
+	uint16_t faixaMaxima;
+	int classes;
+	int tarefas;
+	uint8_t classe[65536];
+};
+
+static Opcoes opcoes;
+
+
+//ESTATÍSTICAS
+
+struct Estatisticas {
+	uint16_t minimo;
+	uint16_t maximo;
+	uint32_t soma;
+	uint32_t fora;
+};
+
+static void acumular(const uint8_t *pares, size_t quantidade, Estatisticas &e){
+	/****************************************************************************************************************************
+	Laço sem desvios sobre as medidas: cada par é lido, trocado para a ordem do computador e acumulado. A soma cabe em 32 bits,
+	pois uma 24C512 guarda no máximo 32767 medidas de até 65535
+	****************************************************************************************************************************/
+	uint16_t minimo = e.minimo, maximo = e.maximo;
+	uint32_t soma = e.soma, fora = e.fora;
+	const uint16_t faixaMinima = opcoes.faixaMinima, faixaMaxima = opcoes.faixaMaxima;
+
+	for (size_t i = 0; i < quantidade; i++){
+		uint16_t valor;
+		memcpy(&valor, pares + 2 * i, 2);
+		valor = __builtin_bswap16(valor);
+
+		minimo = valor < minimo ? valor : minimo;
+		maximo = valor > maximo ? valor : maximo;
+		soma += valor;
+		fora += (valor < faixaMinima) | (valor > faixaMaxima);
+	}
+
+	e.minimo = minimo;
+	e.maximo = maximo;
+	e.soma = soma;
+	e.fora = fora;
+}
+
+static void contarClasses(const uint8_t *pares, size_t quantidade, uint32_t *contagem){
+	//'contagem' tem uma posição a mais, FORA_DA_FAIXA, que recebe os valores fora da faixa e é descartada
+	for (size_t i = 0; i < quantidade; i++){
+		contagem[opcoes.classe[pares[2 * i] << 8 | pares[2 * i + 1]]]++;
+	}
+}
+
+static void analisar(const uint8_t *imagem, Resultado &r){
+	r.histograma.assign(opcoes.classes, 0);
+
+	if (r.tamanho < TAMANHO_MINIMO || r.tamanho > TAMANHO_MAXIMO || (r.tamanho & (r.tamanho - 1))){
+		r.situacao = tamanhoInvalido;
+		return;
+	}
+
+	//Mesmo par da quantidade usado pelo firmware quando a imagem é da memória da placa, senão o último par
+	uint32_t enderecoQuantidade = r.tamanho - 2;
+	if (r.tamanho == Placa::Memoria::tamanho){
+		enderecoQuantidade = Placa::Memoria::enderecoQuantidade;
+	}
+
+	//Todos os pares, menos o da quantidade
+	uint32_t capacidade = r.tamanho / 2 - 1;
+
+	r.quantidade = imagem[enderecoQuantidade] << 8 | imagem[enderecoQuantidade + 1];
+	if (r.quantidade == 0xFFFF){
+		r.situacao = nuncaApagada;
+		return;
+	}
+	if (r.quantidade > capacidade){
+		r.situacao = quantidadeInvalida;
+		return;
+	}
+
+	//As medidas são lidas em dois trechos, antes e depois do par da quantidade
+	size_t antes = std::min<size_t>(r.quantidade, enderecoQuantidade / 2);
+	size_t depois = r.quantidade - antes;
+
+	Estatisticas e = {0xFFFF, 0, 0, 0};
+	acumular(imagem, antes, e);
+	acumular(imagem + enderecoQuantidade + 2, depois, e);
+
+	uint32_t contagem[FORA_DA_FAIXA + 1] = {0};
+	contarClasses(imagem, antes, contagem);
+	contarClasses(imagem + enderecoQuantidade + 2, depois, contagem);
+
+	r.minimo = r.quantidade ? e.minimo : 0;
+	r.maximo = e.maximo;
+	r.soma = e.soma;
+	r.fora = e.fora;
+	std::copy(contagem, contagem + opcoes.classes, r.histograma.begin());
+}
+
+static void processarArquivo(Resultado &r){
+	int descritor = open(r.arquivo.c_str(), O_RDONLY);
+	struct stat informacoes;
+
+	if (descritor < 0 || fstat(descritor, &informacoes) < 0){
+		r.situacao = erroLeitura;
+		if (descritor >= 0){
+			close(descritor);
+		}
+		return;
+	}
+
+	//O tamanho é conferido antes de ser reduzido a 32 bits; arquivos acima de 4 GB aparecem com 4294967295
+	if (informacoes.st_size < TAMANHO_MINIMO || informacoes.st_size > TAMANHO_MAXIMO){
+		r.tamanho = std::min<off_t>(informacoes.st_size, UINT32_MAX);
+		r.situacao = tamanhoInvalido;
+		close(descritor);
+		return;
+	}
+	r.tamanho = informacoes.st_size;
+
+	void *imagem = mmap(NULL, r.tamanho, PROT_READ, MAP_PRIVATE | MAP_POPULATE, descritor, 0);
+	close(descritor);
+
+	if (imagem == MAP_FAILED){
+		r.situacao = erroLeitura;
+		return;
+	}
+
+	analisar((const uint8_t *) imagem, r);
+	munmap(imagem, r.tamanho);
+}
+
+
+//ARQUIVOS
+
+static void listarArquivos(const std::string &caminho, std::vector<std::string> &arquivos){
+	struct stat informacoes;
+	if (stat(caminho.c_str(), &informacoes) < 0 || !S_ISDIR(informacoes.st_mode)){
+		arquivos.push_back(caminho);
+		return;
+	}
+
+	DIR *diretorio = opendir(caminho.c_str());
+	if (!diretorio){
+		arquivos.push_back(caminho);
+		return;
+	}
+
+	std::vector<std::string> nomes;
+	while (struct dirent *entrada = readdir(diretorio)){
+		if (entrada->d_name[0] != '.'){
+			nomes.push_back(entrada->d_name);
+		}
+	}
+	closedir(diretorio);
+
+	//Ordem alfabética, para que a saída seja a mesma em qualquer sistema de arquivos
+	std::sort(nomes.begin(), nomes.end());
+	for (size_t i = 0; i < nomes.size(); i++){
+		listarArquivos(caminho + "/" + nomes[i], arquivos);
+	}
+}
+
+
+//SAÍDAS
+
+static void escreverTextoCSV(FILE *saida, const std::string &texto){
+	//Sempre entre aspas e com as aspas duplicadas (RFC 4180), para que vírgulas e quebras de linha no nome não mudem as colunas
+	fputc('"', saida);
+	for (size_t i = 0; i < texto.size(); i++){
+		if (texto[i] == '"'){
+			fputc('"', saida);
+		}
+		fputc(texto[i], saida);
+	}
+	fputc('"', saida);
+}
+
+static bool escreverCSV(FILE *saida, const std::vector<Resultado> &resultados){
+	fprintf(saida, "arquivo,situacao,tamanho,quantidade,minimo,maximo,media,fora_da_faixa");
+	for (int i = 0; i < opcoes.classes; i++){
+		fprintf(saida, ",h%d", i);
+	}
+	fputc('\n', saida);
+
+	for (size_t i = 0; i < resultados.size(); i++){
+		const Resultado &r = resultados[i];
+
+		escreverTextoCSV(saida, r.arquivo);
+		fprintf(saida, ",%s,%u,", nomeSituacao[r.situacao], r.tamanho);
+		if (r.situacao != ok){
+			fprintf(saida, ",,,,");
+		}
+		else if (r.quantidade == 0){
+			fprintf(saida, "%u,,,,0", r.quantidade);
+		}
+		else {
+			fprintf(saida, "%u,%.2f,%.2f,%.2f,%u", r.quantidade, r.minimo / 100.0, r.maximo / 100.0,
+				(double) r.soma / r.quantidade / 100.0, r.fora);
+		}
+
+		for (int c = 0; c < opcoes.classes; c++){
+			fprintf(saida, ",%u", r.histograma[c]);
+		}
+		fputc('\n', saida);
+	}
+
+	return fflush(saida) == 0 && !ferror(saida);
+}
+
+template <class T, class F>
+static void escreverColuna(FILE *saida, const std::vector<Resultado> &resultados, F valor){
+	std::vector<T> coluna(resultados.size());
+	for (size_t i = 0; i < resultados.size(); i++){
+		coluna[i] = valor(resultados[i]);
+	}
+	fwrite(coluna.data(), sizeof(T), coluna.size(), saida);
+}
+
+static bool escreverColunar(const char *arquivo, const std::vector<Resultado> &resultados){
+	FILE *saida = fopen(arquivo, "wb");
+	if (!saida){
+		return false;
+	}
+
+	uint32_t linhas = resultados.size();
+	uint32_t classes = opcoes.classes;
+	float faixa[2] = {opcoes.faixaMinima / 100.0f, opcoes.faixaMaxima / 100.0f};
+
+	fwrite("DLCOLUNA", 1, 8, saida);
+	fwrite(&linhas, sizeof linhas, 1, saida);
+	fwrite(&classes, sizeof classes, 1, saida);
+	fwrite(faixa, sizeof faixa, 1, saida);
+
+	escreverColuna<uint8_t>(saida, resultados, [](const Resultado &r){ return r.situacao; });
+	escreverColuna<uint32_t>(saida, resultados, [](const Resultado &r){ return r.tamanho; });
+	escreverColuna<uint16_t>(saida, resultados, [](const Resultado &r){ return r.quantidade; });
+	escreverColuna<float>(saida, resultados, [](const Resultado &r){ return r.minimo / 100.0f; });
+	escreverColuna<float>(saida, resultados, [](const Resultado &r){ return r.maximo / 100.0f; });
+	escreverColuna<float>(saida, resultados, [](const Resultado &r){
+		return r.quantidade && r.situacao == ok ? (float) ((double) r.soma / r.quantidade / 100.0) : 0.0f;
+	});
+	escreverColuna<uint32_t>(saida, resultados, [](const Resultado &r){ return r.fora; });
+
+	for (uint32_t c = 0; c < classes; c++){
+		escreverColuna<uint32_t>(saida, resultados, [c](const Resultado &r){ return r.histograma[c]; });
+	}
+
+	uint32_t fim = 0;
+	escreverColuna<uint32_t>(saida, resultados, [&fim](const Resultado &r){ return fim += r.arquivo.size(); });
+	for (size_t i = 0; i < resultados.size(); i++){
+		fwrite(resultados[i].arquivo.data(), 1, resultados[i].arquivo.size(), saida);
+	}
+
+	bool ok = !ferror(saida);
+	return fclose(saida) == 0 && ok;
+}
+
+static void resumo(const std::vector<Resultado> &resultados, double segundos){
+	unsigned validas = 0, invalidas = 0;
+	uint64_t medidas = 0, soma = 0, fora = 0, bytes = 0;
+	uint16_t minimo = 0xFFFF, maximo = 0;
+
+	for (size_t i = 0; i < resultados.size(); i++){
+		const Resultado &r = resultados[i];
+		if (r.tamanho <= TAMANHO_MAXIMO){
+			bytes += r.tamanho;		//arquivos maiores não chegam a ser mapeados
+		}
+
+		if (r.situacao != ok){
+			invalidas++;
+			continue;
+		}
+
+		validas++;
+		medidas += r.quantidade;
+		soma += r.soma;
+		fora += r.fora;
+		if (r.quantidade){
+			minimo = std::min(minimo, r.minimo);
+			maximo = std::max(maximo, r.maximo);
+		}
+	}
+
+	fprintf(stderr, "%u imagens: %u validas, %u invalidas\n", (unsigned) resultados.size(), validas, invalidas);
+	if (medidas){
+		fprintf(stderr, "%llu medidas: minimo %.2f, maximo %.2f, media %.2f, %llu fora da faixa\n",
+			(unsigned long long) medidas, minimo / 100.0, maximo / 100.0, (double) soma / medidas / 100.0,
+			(unsigned long long) fora);
+	}
+	fprintf(stderr, "%.3f s, %.0f imagens/s, %.1f MB/s com %d threads\n", segundos,
+		resultados.size() / std::max(segundos, 1e-9), bytes / 1e6 / std::max(segundos, 1e-9), opcoes.tarefas);
+}
+
+
+static void prepararClasses(){
+	/****************************************************************************************************************************
+	Tabela com a classe do histograma de cada valor de 16 bits: a faixa válida é dividida em 'classes' partes iguais e os
+	valores fora dela recebem FORA_DA_FAIXA
+	****************************************************************************************************************************/
+	uint32_t largura = opcoes.faixaMaxima - opcoes.faixaMinima + 1;
+
+	for (uint32_t valor = 0; valor < 65536; valor++){
+		if (valor < opcoes.faixaMinima || valor > opcoes.faixaMaxima){
+			opcoes.classe[valor] = FORA_DA_FAIXA;
+		}
+		else {
+			opcoes.classe[valor] = (valor - opcoes.faixaMinima) * opcoes.classes / largura;
+		}
+	}
+}
+
+static int uso(const char *programa){
+	fprintf(stderr, "uso: %s [--csv <arquivo>] [--colunar <arquivo>] [--min <C>] [--max <C>] [--classes <n>] "
+		"[--tarefas <n>] <imagem ou diretorio>...\n", programa);
+	return 2;
+}
+
+int main(int argc, char **argv){
+	const char *csv = NULL;
+	const char *colunar = NULL;
+	double faixaMinima = 2, faixaMaxima = 150;
+	std::vector<std::string> arquivos;
+
+	opcoes.classes = 10;
+	opcoes.tarefas = std::max(1u, std::thread::hardware_concurrency());
+
+	for (int i = 1; i < argc; i++){
+		if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc){
+			csv = argv[++i];
+		}
+		else if (strcmp(argv[i], "--colunar") == 0 && i + 1 < argc){
+			colunar = argv[++i];
+		}
+		else if (strcmp(argv[i], "--min") == 0 && i + 1 < argc){
+			faixaMinima = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--max") == 0 && i + 1 < argc){
+			faixaMaxima = atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--classes") == 0 && i + 1 < argc){
+			opcoes.classes = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--tarefas") == 0 && i + 1 < argc){
+			opcoes.tarefas = atoi(argv[++i]);
+		}
+		else if (argv[i][0] == '-' && argv[i][1] != '\0'){
+			return uso(argv[0]);
+		}
+		else {
+			listarArquivos(argv[i], arquivos);
+		}
+	}
+
+	if (arquivos.empty() || opcoes.classes < 1 || opcoes.classes > MAXIMO_CLASSES || opcoes.tarefas < 1
+			|| faixaMinima < 0 || faixaMaxima > 655.35 || faixaMinima > faixaMaxima){
+		return uso(argv[0]);
+	}
+
+	opcoes.faixaMinima = (uint16_t) (faixaMinima * 100 + 0.5);
+	opcoes.faixaMaxima = (uint16_t) (faixaMaxima * 100 + 0.5);
+	prepararClasses();
+
+	std::chrono::steady_clock::time_point inicio = std::chrono::steady_clock::now();
+
+	//Cada thread pega o próximo arquivo ainda não processado; os resultados ficam na ordem da lista
+	std::vector<Resultado> resultados(arquivos.size());
+	std::atomic<size_t> proximo(0);
+	std::vector<std::thread> threads;
+
+	for (int t = 0; t < opcoes.tarefas; t++){
+		threads.push_back(std::thread([&](){
+			for (size_t i = proximo++; i < arquivos.size(); i = proximo++){
+				Resultado &r = resultados[i];
+				r.arquivo = arquivos[i];
+				r.situacao = ok;
+				r.tamanho = r.quantidade = r.minimo = r.maximo = 0;
+				r.soma = r.fora = 0;
+				processarArquivo(r);
+				if (r.histograma.empty()){
+					r.histograma.assign(opcoes.classes, 0);
+				}
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); t++){
+		threads[t].join();
+	}
+
+	double segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+	FILE *saida = csv && strcmp(csv, "-") != 0 ? fopen(csv, "w") : stdout;
+	if (!saida || !escreverCSV(saida, resultados)){
+		fprintf(stderr, "%s: nao foi possivel gravar\n", saida == stdout ? "stdout" : csv);
+		return 2;
+	}
+	if (saida != stdout){
+		fclose(saida);
+	}
+
+	if (colunar && !escreverColunar(colunar, resultados)){
+		fprintf(stderr, "%s: nao foi possivel gravar\n", colunar);
+		return 2;
+	}
+
+	resumo(resultados, segundos);
+	return 0;
+}
@@ -0,0 +1,91 @@
+#!/bin/sh
+# ******************************************************************************************************************************
+# Compilação e teste de todas as variantes de placa
+#
+# Para cada variante declarada em Placa.h (typedef ConfiguracaoPlaca<...> Placa...):
+#	- firmware: Datalogger.c e Placa.h são copiados para o sketch <saida>/<variante>/Datalogger/Datalogger.ino e compilados
+#	  com o arduino-cli, com -DPLACA=<variante>; o ELF e o HEX ficam em <saida>/<variante>/
+#	- memória: avr-size do ELF e o orçamento de RAM de ferramentas/orcamento_memoria.py, que falha se a reserva estourar
+#	- simulador: compilado com g++ para a mesma variante em <saida>/<variante>/simulador, seguido do autoteste
+# O script termina com código 1 na primeira variante que não compilar, estourar o orçamento de RAM ou falhar no autoteste.
+#
+# O firmware precisa do arduino-cli com o núcleo arduino:avr e a biblioteca LiquidCrystal instalados:
+#	arduino-cli core install arduino:avr && arduino-cli lib install LiquidCrystal
+# O avr-size e o avr-objdump são procurados no PATH e depois no toolchain instalado pelo arduino-cli; --prefixo indica outro.
+#
+# Uso (a partir da raiz do repositório):
+#	sh ferramentas/compilar_variantes.sh [--somente-simulador] [--fqbn arduino:avr:uno] [--rodadas <n>] [--saida compilacao]
+#		[--prefixo <caminho>/avr-]
+# ******************************************************************************************************************************
+
+set -e
+
+FQBN=arduino:avr:uno
+RODADAS=20
+SAIDA=compilacao
+FIRMWARE=1
+PREFIXO=
+
+while [ $# -gt 0 ]; do
+	case "$1" in
+		--somente-simulador) FIRMWARE=0 ;;
+		--fqbn) FQBN="$2"; shift ;;
+		--rodadas) RODADAS="$2"; shift ;;
+		--saida) SAIDA="$2"; shift ;;
+		--prefixo) PREFIXO="$2"; shift ;;
+		*) echo "uso: $0 [--somente-simulador] [--fqbn <placa>] [--rodadas <n>] [--saida <diretorio>] [--prefixo <avr->]" >&2
+			exit 2 ;;
+	esac
+	shift
+done
+
+if [ ! -f Datalogger.c ] || [ ! -f Placa.h ]; then
+	echo "$0: execute a partir da raiz do repositorio" >&2
+	exit 2
+fi
+
+if [ "$FIRMWARE" = 1 ] && ! command -v arduino-cli > /dev/null; then
+	echo "$0: arduino-cli nao encontrado; instale-o ou use --somente-simulador" >&2
+	exit 2
+fi
+
+if [ "$FIRMWARE" = 1 ] && [ -z "$PREFIXO" ]; then
+	if command -v avr-size > /dev/null; then
+		PREFIXO=avr-
+	else
+		for FERRAMENTA in "$HOME"/.arduino15/packages/arduino/tools/avr-gcc/*/bin/avr-size; do
+			[ -x "$FERRAMENTA" ] && PREFIXO="${FERRAMENTA%size}"
+		done
+	fi
+	if [ -z "$PREFIXO" ]; then
+		echo "$0: avr-size nao encontrado; use --prefixo <caminho>/avr-" >&2
+		exit 2
+	fi
+fi
+
+VARIANTES=$(sed -n 's/^typedef ConfiguracaoPlaca<.*> \(Placa[A-Za-z0-9_]*\);.*$/\1/p' Placa.h)
+
+for VARIANTE in $VARIANTES; do
+	echo "== $VARIANTE"
+	DESTINO="$SAIDA/$VARIANTE"
+	mkdir -p "$DESTINO"
+
+	if [ "$FIRMWARE" = 1 ]; then
+		#O arduino-cli exige um diretório com o mesmo nome do sketch, e um .c seria compilado como C
+		mkdir -p "$DESTINO/Datalogger"
+		cp Datalogger.c "$DESTINO/Datalogger/Datalogger.ino"
+		cp Placa.h "$DESTINO/Datalogger/"
+
+		arduino-cli compile --fqbn "$FQBN" --output-dir "$DESTINO" \
+			--build-property "compiler.cpp.extra_flags=-DPLACA=$VARIANTE" "$DESTINO/Datalogger"
+
+		"${PREFIXO}size" "$DESTINO/Datalogger.ino.elf"
+		python3 ferramentas/orcamento_memoria.py "$DESTINO/Datalogger.ino.elf" --prefixo "$PREFIXO"
+	fi
+
+	g++ -std=c++11 -O2 -fsigned-char -Wall -Wextra -DPLACA="$VARIANTE" -I ferramentas/simulador \
+		ferramentas/simulador/simulador.cpp -o "$DESTINO/simulador"
+	"$DESTINO/simulador" --autoteste --rodadas "$RODADAS"
+done
+
+echo "todas as variantes compiladas e testadas"
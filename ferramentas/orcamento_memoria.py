@@ -0,0 +1,335 @@
+#!/usr/bin/env python3
+# ******************************************************************************************************************************
+# Relatório e orçamento de memória RAM do Datalogger
+#
+# A partir do ELF gerado pela compilação do firmware, calcula:
+#	- RAM estática: seções .data, .bss e .noinit (avr-size)
+#	- Pior caso da pilha: maior soma de quadros de pilha ao longo do grafo de chamadas a partir de main, mais a maior
+#	  interrupção, que pode ocorrer no ponto mais profundo (avr-objdump)
+#	- RAM livre para heap e buffers: o que sobra entre a RAM estática e o pior caso da pilha
+# e termina com código 1 caso a RAM livre fique abaixo da reserva pedida.
+#
+# O quadro de cada função é obtido somente do prólogo gerado pelo avr-gcc: cada 'push' ocupa 1 byte, cada 'rcall .+0'
+# 2 bytes e o espaço das variáveis locais é lido de 'sbiw r28, N' ou 'subi r28, N' / 'sbc r29, r1' ou 'sbci r29, M' logo
+# após 'in r28, 0x3d' e 'in r29, 0x3e'. O prólogo termina na primeira instrução que não seja dele, de forma que a devolução
+# do espaço no epílogo ('subi r28, lo8(-N)') e a aritmética com o ponteiro Y no corpo da função não são somadas ao quadro.
+# Cada 'call' ou 'rcall' acrescenta os 2 bytes do endereço de retorno; um 'jmp' para o início de outra função é tratado como
+# chamada de cauda. Recursão é considerada erro, pois a pilha não teria limite.
+#
+# Chamadas indiretas ('icall'):
+#	- Funções virtuais: o avr-gcc lê o endereço da função da tabela virtual com 'ld'/'ldd' relativos a Z antes do 'icall',
+#	  o que dá a posição usada na tabela. Os alvos são somente as funções nessa posição das tabelas virtuais (_ZTV*) do ELF
+#	- Ponteiros guardados em tempo de execução, como os da interrupção do TWI (twi_onSlaveTransmit/twi_onSlaveReceive), não
+#	  aparecem no ELF e são declarados em ALVOS_INDIRETOS ou com --indireta FUNCAO=ALVO[,ALVO...]
+#	- Chamadas que não se encaixam em nenhum dos dois casos consideram todas as funções virtuais, com um aviso
+# Funções compiladas com -mcall-prologues não são suportadas.
+#
+# Uso:
+#	python3 ferramentas/orcamento_memoria.py Datalogger.ino.elf [--ram 2048] [--reserva 512]
+#
+# Para executar a cada compilação com o arduino-cli, fazendo a compilação falhar quando o orçamento estourar:
+#	arduino-cli compile --build-property "recipe.hooks.objcopy.postobjcopy.1.pattern=python3
+#		{build.source.path}/ferramentas/orcamento_memoria.py {build.path}/{build.project_name}.elf" ...
+# ******************************************************************************************************************************
+
+import argparse
+import re
+import subprocess
+import sys
+
+
+RE_FUNCAO = re.compile(r'^([0-9a-f]+) <(.+)>:$')
+RE_INSTRUCAO = re.compile(r'^\s*([0-9a-f]+):\s+(?:[0-9a-f]{2} )+\s*(\S+)\s*([^;]*?)\s*(?:;\s*(.*))?$')
+RE_ALVO = re.compile(r'0x([0-9a-f]+) <([^>+]+)(\+0x[0-9a-f]+)?>')
+RE_IMEDIATO = re.compile(r'r(\d+), 0x([0-9a-f]+)')
+
+# Instruções que podem aparecer no prólogo sem alterar o quadro: leitura de SP e SREG, zeragem de r1 nas interrupções e a
+# escrita do novo SP com as interrupções desabilitadas
+PROLOGO = ('in', 'out', 'cli', 'eor', 'clr')
+
+# Instruções cujo primeiro operando 'rN' não é escrito
+SEM_ESCRITA = ('st', 'std', 'sts', 'out', 'cp', 'cpc', 'cpi', 'cpse', 'tst', 'sbrc', 'sbrs', 'bst', 'push')
+
+RE_CARGA_Z = re.compile(r'r(\d+), Z(\+(\d+)?)?$')
+RE_TABELA_VIRTUAL = re.compile(r'^([0-9a-f]+)\s.*\s\.data\s+([0-9a-f]+)\s+(_ZTV\S+)$')
+
+# Alvos de ponteiros para funções preenchidos em tempo de execução pelas bibliotecas usadas no firmware. A interrupção do
+# TWI chama os serviços da classe TwoWire, que só chamariam funções do usuário registradas com onReceive/onRequest, que o
+# Datalogger não usa
+ALVOS_INDIRETOS = {
+	'__vector_24': ['_ZN7TwoWire16onReceiveServiceEPhi', '_ZN7TwoWire16onRequestServiceEv'],
+	'_ZN7TwoWire16onReceiveServiceEPhi': [],
+	'_ZN7TwoWire16onRequestServiceEv': [],
+}
+
+
+def executar(comando):
+	try:
+		return subprocess.run(comando, check=True, capture_output=True, text=True).stdout
+	except FileNotFoundError:
+		sys.exit('%s nao encontrado; instale o toolchain avr-gcc ou use --prefixo' % comando[0])
+	except subprocess.CalledProcessError as erro:
+		sys.exit('%s falhou:\n%s' % (' '.join(comando), erro.stderr))
+
+
+def ler_secoes(texto_size):
+	# Saída de 'avr-size -A': nome, tamanho e endereço de cada seção
+	secoes = {}
+	for linha in texto_size.splitlines():
+		campos = linha.split()
+		if len(campos) >= 2 and campos[0].startswith('.') and campos[1].isdigit():
+			secoes[campos[0]] = int(campos[1])
+	return secoes
+
+
+class Funcao:
+	def __init__(self, nome, endereco):
+		self.nome = nome
+		self.endereco = endereco
+		self.quadro = 0
+		self.chamadas = set()
+		self.caudas = set()
+		self.posicoes = set()		#posições nas tabelas virtuais dos 'icall'; None quando não identificada
+
+
+def ler_funcoes(texto_objdump):
+	# Saída de 'avr-objdump -d': quadro de pilha e chamadas de cada função
+	funcoes = {}
+	atual = None
+
+	for linha in texto_objdump.splitlines():
+		inicio = RE_FUNCAO.match(linha)
+		if inicio:
+			atual = Funcao(inicio.group(2), int(inicio.group(1), 16))
+			funcoes[atual.nome] = atual
+			prologo = True
+			ponteiro_y = False		#'in r28, 0x3d' já lido, o próximo ajuste de Y reserva as variáveis locais
+			ajustado = False
+			cargas_z = {}			#registrador -> deslocamento em Z de onde foi carregado
+			incremento_z = 0		#incrementos de Z por 'ld rN, Z+' desde que Z foi carregado
+			posicao = None			#deslocamento do endereço carregado em r30 para o próximo 'icall'
+			continue
+
+		instrucao = RE_INSTRUCAO.match(linha)
+		if not atual or not instrucao:
+			continue
+
+		mnemonico, operandos, comentario = instrucao.group(2), instrucao.group(3), instrucao.group(4) or ''
+		alvo = RE_ALVO.search(comentario)
+
+		if prologo:
+			imediato = RE_IMEDIATO.match(operandos)
+			registrador = int(imediato.group(1)) if imediato else None
+			valor = int(imediato.group(2), 16) if imediato else 0
+
+			if mnemonico == 'push':
+				atual.quadro += 1
+				continue
+			if mnemonico == 'rcall' and operandos.startswith('.+0'):
+				atual.quadro += 2
+				continue
+			if mnemonico == 'in' and operandos.startswith('r28'):
+				ponteiro_y = True
+				continue
+			if ponteiro_y and not ajustado and mnemonico == 'sbc' and operandos.replace(' ', '') == 'r29,r1':
+				ajustado = True
+				continue
+			if ponteiro_y and not ajustado and imediato:
+				if mnemonico == 'sbiw' and registrador == 28:
+					atual.quadro += valor
+					ajustado = True
+					continue
+				if mnemonico == 'subi' and registrador == 28:
+					atual.quadro += valor
+					continue
+				if mnemonico == 'sbci' and registrador == 29:
+					atual.quadro += valor << 8
+					ajustado = True
+					continue
+			if mnemonico in PROLOGO:
+				continue
+			prologo = False
+
+		if mnemonico in ('call', 'rcall') and alvo and not alvo.group(3):
+			atual.chamadas.add(alvo.group(2))
+		elif mnemonico in ('jmp', 'rjmp') and alvo and not alvo.group(3) and alvo.group(2) != atual.nome:
+			atual.caudas.add(alvo.group(2))
+		elif mnemonico in ('icall', 'eicall', 'ijmp', 'eijmp'):
+			atual.posicoes.add(posicao)
+			posicao = None
+
+		# Origem do endereço em r30:r31: 'ld r0, Z+' / 'ld r31, Z' / 'mov r30, r0' ou 'ldd r24, Z+2' / ... / 'movw r30, r24'
+		carga = RE_CARGA_Z.match(operandos) if mnemonico in ('ld', 'ldd') else None
+		destino = re.match(r'r(\d+)', operandos) if mnemonico not in SEM_ESCRITA else None
+		if carga:
+			cargas_z[int(carga.group(1))] = int(carga.group(3) or 0) + incremento_z
+			if carga.group(2) == '+':
+				incremento_z += 1
+		elif destino:
+			registrador = int(destino.group(1))
+			origem = re.search(r', r(\d+)$', operandos)
+			if registrador == 30 and mnemonico in ('mov', 'movw') and origem:
+				posicao = cargas_z.get(int(origem.group(1)))
+			elif registrador in (30, 31):
+				posicao = None
+			cargas_z.pop(registrador, None)
+			if registrador in (30, 31):
+				incremento_z = 0
+				cargas_z = {}
+			if mnemonico == 'movw':
+				cargas_z.pop(registrador + 1, None)
+
+	return funcoes
+
+
+def ler_tabelas_virtuais(texto_simbolos, texto_data, funcoes):
+	# Saídas de 'avr-objdump -t' e 'avr-objdump -s -j .data': para cada tabela virtual, a função de cada posição a partir do
+	# ponto para onde o objeto aponta (depois do deslocamento e do typeinfo, 2 bytes cada)
+	por_endereco = {f.endereco: f.nome for f in funcoes.values()}
+	dados = {}
+	for linha in texto_data.splitlines():
+		campos = linha.split()
+		if len(campos) >= 2 and re.fullmatch(r'[0-9a-f]+', campos[0]):
+			endereco = int(campos[0], 16)
+			for grupo in campos[1:5]:
+				if re.fullmatch(r'[0-9a-f]+', grupo):
+					for byte in bytes.fromhex(grupo):
+						dados[endereco] = byte
+						endereco += 1
+
+	tabelas = {}
+	for linha in texto_simbolos.splitlines():
+		simbolo = RE_TABELA_VIRTUAL.match(linha.strip())
+		if not simbolo:
+			continue
+		inicio, tamanho = int(simbolo.group(1), 16), int(simbolo.group(2), 16)
+		posicoes = {}
+		for deslocamento in range(0, tamanho - 4, 2):
+			endereco = inicio + 4 + deslocamento
+			palavra = dados.get(endereco, 0) | dados.get(endereco + 1, 0) << 8
+			nome = por_endereco.get(palavra * 2)
+			# Funções virtuais puras apontam para __cxa_pure_virtual, que nunca retorna
+			if nome and not nome.startswith('__'):
+				posicoes[deslocamento] = nome
+		tabelas[simbolo.group(3)] = posicoes
+	return tabelas
+
+
+def resolver_indiretas(funcoes, tabelas, declarados):
+	# Alvos das chamadas indiretas de cada função e a lista das que não puderam ser identificadas
+	todas = set(nome for posicoes in tabelas.values() for nome in posicoes.values())
+	alvos, sem_alvo = {}, []
+	for funcao in funcoes.values():
+		if not funcao.posicoes:
+			continue
+		if funcao.nome in declarados:
+			alvos[funcao.nome] = set(declarados[funcao.nome])
+			continue
+		alvos[funcao.nome] = set()
+		for posicao in funcao.posicoes:
+			if posicao is None:
+				alvos[funcao.nome] |= todas
+				sem_alvo.append(funcao.nome)
+			else:
+				alvos[funcao.nome] |= set(p[posicao] for p in tabelas.values() if posicao in p)
+	return alvos, sorted(set(sem_alvo))
+
+
+def profundidade(nome, funcoes, alvos_indiretos, memo, caminho):
+	# Maior uso de pilha a partir da entrada de 'nome', com o caminho de chamadas correspondente
+	if nome in memo:
+		return memo[nome]
+	if nome in caminho:
+		sys.exit('recursao encontrada: %s' % ' -> '.join(caminho + [nome]))
+
+	funcao = funcoes.get(nome)
+	if not funcao:
+		memo[nome] = (0, [nome])
+		return memo[nome]
+
+	caminho.append(nome)
+	maior = (funcao.quadro, [nome])
+	chamadas = funcao.chamadas | alvos_indiretos.get(nome, set())
+	for chamada in sorted(chamadas):
+		if chamada == nome:
+			continue
+		bytes_chamada, cadeia = profundidade(chamada, funcoes, alvos_indiretos, memo, caminho)
+		if funcao.quadro + 2 + bytes_chamada > maior[0]:
+			maior = (funcao.quadro + 2 + bytes_chamada, [nome] + cadeia)
+
+	for cauda in sorted(funcao.caudas):
+		bytes_cauda, cadeia = profundidade(cauda, funcoes, alvos_indiretos, memo, caminho)
+		if bytes_cauda > maior[0]:
+			maior = (bytes_cauda, [nome] + cadeia)
+
+	caminho.pop()
+	memo[nome] = maior
+	return maior
+
+
+def main():
+	argumentos = argparse.ArgumentParser(description='Relatorio e orcamento de RAM do firmware')
+	argumentos.add_argument('elf')
+	argumentos.add_argument('--ram', type=int, default=2048, help='RAM do microcontrolador, em bytes (ATmega328P: 2048)')
+	argumentos.add_argument('--reserva', type=int, default=512,
+		help='RAM que deve sobrar para heap e buffers, em bytes')
+	argumentos.add_argument('--prefixo', default='avr-', help='prefixo das ferramentas do toolchain')
+	argumentos.add_argument('--indireta', action='append', default=[], metavar='FUNCAO=ALVO[,ALVO...]',
+		help='alvos das chamadas indiretas de FUNCAO, no lugar dos identificados automaticamente')
+	opcoes = argumentos.parse_args()
+
+	declarados = dict(ALVOS_INDIRETOS)
+	for declaracao in opcoes.indireta:
+		funcao, _, alvos = declaracao.partition('=')
+		declarados[funcao] = [alvo for alvo in alvos.split(',') if alvo]
+
+	secoes = ler_secoes(executar([opcoes.prefixo + 'size', '-A', opcoes.elf]))
+	funcoes = ler_funcoes(executar([opcoes.prefixo + 'objdump', '-d', opcoes.elf]))
+	tabelas = ler_tabelas_virtuais(executar([opcoes.prefixo + 'objdump', '-t', opcoes.elf]),
+		executar([opcoes.prefixo + 'objdump', '-s', '-j', '.data', opcoes.elf]), funcoes)
+	alvos_indiretos, sem_alvo = resolver_indiretas(funcoes, tabelas, declarados)
+
+	if 'main' not in funcoes:
+		sys.exit('%s: funcao main nao encontrada' % opcoes.elf)
+
+	memo = {}
+	pilha_main, cadeia_main = profundidade('main', funcoes, alvos_indiretos, memo, [])
+	pilha_main += 2		#endereço de retorno da chamada de main pelo código de inicialização
+
+	# Uma interrupção empilha o endereço de retorno (2 bytes) e as interrupções não são aninhadas
+	pilha_interrupcao, cadeia_interrupcao = 0, []
+	for nome in sorted(funcoes):
+		if re.fullmatch(r'__vector_\d+', nome):
+			bytes_interrupcao, cadeia = profundidade(nome, funcoes, alvos_indiretos, memo, [])
+			if bytes_interrupcao + 2 > pilha_interrupcao:
+				pilha_interrupcao, cadeia_interrupcao = bytes_interrupcao + 2, cadeia
+
+	estatica = secoes.get('.data', 0) + secoes.get('.bss', 0) + secoes.get('.noinit', 0)
+	pilha = pilha_main + pilha_interrupcao
+	livre = opcoes.ram - estatica - pilha
+
+	print('RAM: %d bytes' % opcoes.ram)
+	print('  .data                 %5d' % secoes.get('.data', 0))
+	print('  .bss                  %5d' % secoes.get('.bss', 0))
+	print('  .noinit               %5d' % secoes.get('.noinit', 0))
+	print('  estatica              %5d' % estatica)
+	print('  pilha (pior caso)     %5d' % pilha)
+	print('    main                %5d  %s' % (pilha_main, ' -> '.join(cadeia_main)))
+	print('    interrupcao         %5d  %s' % (pilha_interrupcao, ' -> '.join(cadeia_interrupcao)))
+	print('  livre (heap/buffers)  %5d' % livre)
+	print('  reserva exigida       %5d' % opcoes.reserva)
+
+	if sem_alvo:
+		print('aviso: chamadas indiretas sem tabela virtual identificada em %s; foram consideradas todas as funcoes virtuais'
+			' (use --indireta)' % ', '.join(sem_alvo))
+
+	if livre < opcoes.reserva:
+		print('ESTOURO: faltam %d bytes para a reserva de RAM' % (opcoes.reserva - livre))
+		return 1
+
+	print('OK')
+	return 0
+
+
+if __name__ == '__main__':
+	sys.exit(main())
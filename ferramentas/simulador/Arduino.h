@@ -0,0 +1,80 @@
+/********************************************************************************************************************************
+Substitutos do núcleo Arduino para compilar o Datalogger.c no Linux
+
+Somente o que o firmware realmente usa é declarado aqui: os registradores de GPIO e do temporizador 0, a leitura analógica, o
+_delay_ms, cli/sei, a macro ISR, o acesso à memória de programa e a porta Serial. Todas as implementações ficam em
+simulador.cpp, onde cada acesso consome tempo do relógio virtual.
+
+A leitura de PINC é feita por uma função, pois o valor das colunas do teclado depende de qual linha está em nível baixo em
+PORTD no instante da leitura.
+********************************************************************************************************************************/
+
+#ifndef SIMULADOR_ARDUINO_H
+#define SIMULADOR_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+//Registradores usados pelo firmware
+extern uint8_t DDRC;
+extern uint8_t PORTC;
+extern uint8_t DDRD;
+extern uint8_t PORTD;
+extern uint8_t TCCR0A;
+extern uint8_t TCCR0B;
+extern uint8_t OCR0A;
+extern uint8_t TIMSK0;
+
+uint8_t simLerPINC();
+#define PINC simLerPINC()
+
+//Entrada analógica
+#define A0 14
+int analogRead(uint8_t pino);
+
+//Atrasos e interrupções
+void _delay_ms(double ms);
+void cli();
+void sei();
+
+#define ISR(vetor) void vetor(void)
+#define TIMER0_COMPA_vect simInterrupcaoTimer0
+void simInterrupcaoTimer0(void);
+
+//Memória de programa: no computador as constantes são lidas diretamente
+#define PROGMEM
+#define pgm_read_byte(endereco) (*(const uint8_t *) (endereco))
+
+class __FlashStringHelper;
+#define F(texto) (reinterpret_cast<const __FlashStringHelper *>(texto))
+
+
+//Impressão formatada, no mesmo formato da classe Print do Arduino
+class Print {
+public:
+	virtual size_t write(uint8_t c) = 0;
+
+	size_t print(const __FlashStringHelper *texto);
+	size_t print(const char *texto);
+	size_t print(char c);
+	size_t print(int n);
+	size_t print(double n, int casas = 2);
+
+	size_t println();
+	size_t println(const char *texto);
+	size_t println(int n);
+	size_t println(double n, int casas = 2);
+};
+
+class HardwareSerial : public Print {
+public:
+	void begin(unsigned long baud);
+	int available();
+	int read();
+	size_t write(uint8_t c);
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,23 @@
+/********************************************************************************************************************************
+Substituto da biblioteca LiquidCrystal para o simulador
+
+O conteúdo das duas linhas do display é guardado em simulador.cpp, e cada comando consome o tempo que a biblioteca original
+gasta com os pulsos de enable no modo de 4 bits
+********************************************************************************************************************************/
+
+#ifndef SIMULADOR_LIQUIDCRYSTAL_H
+#define SIMULADOR_LIQUIDCRYSTAL_H
+
+#include "Arduino.h"
+
+class LiquidCrystal : public Print {
+public:
+	LiquidCrystal(uint8_t rs, uint8_t enable, uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7);
+
+	void begin(uint8_t colunas, uint8_t linhas);
+	void clear();
+	void setCursor(uint8_t coluna, uint8_t linha);
+	size_t write(uint8_t c);
+};
+
+#endif
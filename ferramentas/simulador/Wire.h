@@ -0,0 +1,40 @@
+/********************************************************************************************************************************
+Substituto da biblioteca Wire para o simulador
+
+As transmissões são entregues aos modelos da EEPROM 24C16 e do expansor PCF8574 em simulador.cpp, consumindo o tempo de cada
+bit no barramento I2C a 100 kHz
+
+As sobrecargas são as mesmas da biblioteca Wire do AVR, para que chamadas ambíguas lá também sejam ambíguas aqui
+********************************************************************************************************************************/
+
+#ifndef SIMULADOR_WIRE_H
+#define SIMULADOR_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+	void begin();
+
+	void beginTransmission(uint8_t endereco);
+	void beginTransmission(int endereco);
+	size_t write(uint8_t dado);
+	size_t write(const uint8_t *dados, size_t quantidade);
+	size_t write(unsigned long dado) { return write((uint8_t) dado); }
+	size_t write(long dado) { return write((uint8_t) dado); }
+	size_t write(unsigned int dado) { return write((uint8_t) dado); }
+	size_t write(int dado) { return write((uint8_t) dado); }
+	uint8_t endTransmission();
+	uint8_t endTransmission(uint8_t enviarStop);
+
+	uint8_t requestFrom(uint8_t endereco, uint8_t quantidade);
+	uint8_t requestFrom(uint8_t endereco, uint8_t quantidade, uint8_t enviarStop);
+	uint8_t requestFrom(int endereco, int quantidade);
+	uint8_t requestFrom(int endereco, int quantidade, int enviarStop);
+	int available();
+	int read();
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,1321 @@
+/********************************************************************************************************************************
+Simulador determinístico do Datalogger para testes de temporização no Linux
+
+O firmware (Datalogger.c) é compilado sem alterações junto com substitutos do núcleo Arduino, da biblioteca Wire e da biblioteca
+LiquidCrystal. Todo o hardware é trocado por modelos que avançam um relógio virtual, em microssegundos:
+	- Barramento I2C a 100 kHz (9 bits por byte, contando o ACK)
+	- EEPROM 24C16 com páginas de 16 bytes e ciclo de gravação de 5 ms, respondendo com NACK enquanto grava
+	- Expansor PCF8574, de onde são reconstruídos os quadros dos displays de 7 segmentos
+	- Display LCD 16x2, com o tempo gasto pela biblioteca LiquidCrystal em cada comando
+	- UART a 9600 baud com buffer de transmissão de 64 bytes, bloqueando quando o buffer enche
+	- Temporizador 0, gerando a interrupção de acordo com TCCR0A, TCCR0B, OCR0A e TIMSK0 configurados pelo firmware
+	- Teclado matricial, cujas colunas em PINC dependem da linha colocada em nível baixo em PORTD no instante da leitura
+
+Modo traço: reproduz um arquivo de eventos e imprime a linha do tempo com as amostras, as gravações na EEPROM, os quadros do LCD e
+dos displays de 7 segmentos e o que foi enviado pela serial, seguida de um resumo e do conteúdo final da memória.
+Cada linha do arquivo contém o instante em milissegundos, seguido do evento:
+	<ms> adc <0..1023>			valor lido em A0 a partir deste instante
+	<ms> pressiona <tecla>		tecla do teclado matricial pressionada
+	<ms> solta					tecla solta
+	<ms> serial <texto>			texto recebido pela serial, um caractere a cada 1,042 ms
+	<ms> fim					fim da simulação
+Linhas começando com '#' são comentários.
+
+Modo autoteste: executa cenários fixos (coleta periódica, transferência, apagar memória, memória cheia e coleta passando pelo
+par da quantidade) e rodadas de teclas com tempos aleatórios, comparando a máquina de estados 'funcao' do firmware com um
+modelo de referência. Qualquer falha é impressa e o programa termina com código 1, podendo ser usado como teste antes de
+gravar uma nova versão.
+
+Compilação (a partir da raiz do repositório):
+	g++ -std=c++11 -O2 -fsigned-char -Wall -Wextra -I ferramentas/simulador ferramentas/simulador/simulador.cpp -o simulador
+Os modelos seguem a variante de placa escolhida em Placa.h; para simular outra variante basta acrescentar, por exemplo,
+-DPLACA=PlacaP3Compacta na compilação.
+
+Uso:
+	./simulador <traço> [--eeprom <imagem>] [--salvar-eeprom <imagem>] [--duracao <ms>]
+	./simulador --autoteste [--rodadas <n>] [--semente <n>]
+********************************************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "Wire.h"
+#include "LiquidCrystal.h"
+
+//O firmware usa int16_t onde depende do int de 16 bits do AVR, por exemplo ao ler 0xFFFF de uma EEPROM apagada como -1
+#include "../../Datalogger.c"
+
+
+//Custos modelados, em microssegundos
+#define CLOCK_CPU_MHZ			16
+#define CUSTO_BIT_I2C			10		//100 kHz
+#define CUSTO_START_STOP_I2C	10
+#define CUSTO_BYTE_I2C			(9 * CUSTO_BIT_I2C)
+#define CUSTO_CARACTERE_UART	1042	//9600 baud, 10 bits por caractere
+#define CUSTO_COMANDO_LCD		250		//dois pulsos de enable de 100 us, mais os digitalWrite
+#define CUSTO_LIMPAR_LCD		2000
+#define CUSTO_INICIAR_LCD		55000
+#define CUSTO_CONVERSAO_ADC		112		//13 ciclos do ADC a 125 kHz
+#define CUSTO_LOOP				20		//instruções do loop que não passam por nenhum periférico
+#define TEMPO_GRAVACAO_EEPROM	5000
+
+//Periféricos, de acordo com a variante da placa
+#define TAMANHO_BUFFER_UART		64
+#define TAMANHO_EEPROM			Placa::Memoria::tamanho
+#define PAGINA_EEPROM			16
+#define ENDERECO_EEPROM			Placa::Memoria::endereco
+#define BITS_ENDERECO_EEPROM	((TAMANHO_EEPROM - 1) >> 8)
+#define ENDERECO_EXPANSOR		Placa::enderecoExpansor
+#define ENDERECO_QUANTIDADE		Placa::Memoria::enderecoQuantidade
+#define CAPACIDADE_EEPROM		Placa::Memoria::capacidade
+
+//Limites verificados no autoteste
+#define PERIODO_AMOSTRAGEM_MS		Placa::periodoAmostragem
+#define TOLERANCIA_AMOSTRAGEM_MS	25
+#define LIMITE_INTERVALO_7SEG_MS	40
+#define DURACAO_MINIMA_TECLA_MS		50
+
+
+uint8_t DDRC, PORTC, DDRD, PORTD;
+uint8_t TCCR0A, TCCR0B, OCR0A, TIMSK0;
+
+HardwareSerial Serial;
+TwoWire Wire;
+
+
+struct Evento {
+	uint64_t tempo;
+	char tipo;				//'a' adc, 'p' pressiona, 's' solta, 'r' serial
+	int valor;
+	std::string texto;
+};
+
+struct Simulacao {
+	//Relógio virtual e temporizador 0
+	uint64_t agora;
+	uint64_t proximoTick;
+	bool interrupcoes;
+	bool interrupcaoPendente;
+
+	//Entradas
+	std::vector<Evento> eventos;
+	size_t proximoEvento;
+	int adc;
+	char teclaPressionada;
+	int pressionamentos;
+
+	//EEPROM 24C16
+	uint8_t eeprom[TAMANHO_EEPROM];
+	uint16_t ponteiroEEPROM;
+	uint64_t eepromOcupadaAte;
+
+	//Barramento I2C
+	uint8_t enderecoI2C;
+	std::vector<uint8_t> transmissaoI2C;
+	std::deque<uint8_t> recepcaoI2C;
+	unsigned nacks;
+
+	//Displays de 7 segmentos
+	uint8_t digitos7seg[4];
+	bool digitoRecebido[4];
+	std::string quadro7seg;
+	uint64_t ultimaEscritaExpansor;
+	uint64_t maiorIntervaloExpansor;
+
+	//Display LCD
+	char lcd[2][17];
+	uint8_t colunaLCD;
+	uint8_t linhaLCD;
+	bool lcdAlterado;
+
+	//Serial
+	std::deque<uint64_t> filaTX;
+	std::string linhaTX;
+	std::vector<std::string> linhasTX;
+	std::deque<std::pair<uint64_t, uint8_t> > chegadaRX;
+	std::deque<uint8_t> bufferRX;
+	unsigned perdidosRX;
+
+	//Medidas
+	std::vector<uint64_t> amostras;
+	uint64_t maiorLoop;
+	bool ecoar;
+};
+
+static Simulacao sim;
+
+
+//LINHA DO TEMPO
+
+static void registrar(const char *formato, ...){
+	if (!sim.ecoar){
+		return;
+	}
+
+	char texto[160];
+	va_list argumentos;
+	va_start(argumentos, formato);
+	vsnprintf(texto, sizeof texto, formato, argumentos);
+	va_end(argumentos);
+
+	printf("[%11.3f ms] %s\n", sim.agora / 1000.0, texto);
+}
+
+static void registrarLCD(){
+	if (sim.lcdAlterado){
+		registrar("lcd \"%s\" \"%s\"", sim.lcd[0], sim.lcd[1]);
+		sim.lcdAlterado = false;
+	}
+}
+
+
+//RELÓGIO VIRTUAL
+
+static void aplicarEventos(){
+	/****************************************************************************************************************************
+	Aplica todos os eventos do traço cujo instante já foi alcançado pelo relógio virtual e entrega à serial os caracteres que já
+	terminaram de chegar, descartando os que não cabem no buffer de recepção
+	****************************************************************************************************************************/
+	while (sim.proximoEvento < sim.eventos.size() && sim.eventos[sim.proximoEvento].tempo <= sim.agora){
+		const Evento &evento = sim.eventos[sim.proximoEvento++];
+
+		switch (evento.tipo){
+			case 'a':
+				sim.adc = evento.valor;
+				break;
+			case 'p':
+				sim.teclaPressionada = evento.valor;
+				sim.pressionamentos++;
+				registrar("tecla %c pressionada", evento.valor);
+				break;
+			case 's':
+				if (sim.teclaPressionada != -1){
+					registrar("tecla %c solta", sim.teclaPressionada);
+				}
+				sim.teclaPressionada = -1;
+				break;
+			case 'r':
+				for (size_t i = 0; i < evento.texto.size(); i++){
+					sim.chegadaRX.push_back(std::make_pair(evento.tempo + (i + 1) * CUSTO_CARACTERE_UART,
+						(uint8_t) evento.texto[i]));
+				}
+				break;
+		}
+	}
+
+	while (!sim.chegadaRX.empty() && sim.chegadaRX.front().first <= sim.agora){
+		if (sim.bufferRX.size() >= TAMANHO_BUFFER_UART){
+			sim.perdidosRX++;
+			registrar("serial-rx caractere perdido, buffer cheio");
+		}
+		else {
+			sim.bufferRX.push_back(sim.chegadaRX.front().second);
+		}
+		sim.chegadaRX.pop_front();
+	}
+}
+
+static uint32_t periodoTimer0(){
+	/****************************************************************************************************************************
+	Período da interrupção de comparação do temporizador 0, em microssegundos, a partir dos registradores configurados pelo
+	firmware. Somente o modo CTC é modelado; nos outros modos o temporizador é considerado parado
+	****************************************************************************************************************************/
+	static const uint16_t prescaler[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+	if ((TCCR0A & 0x03) != 0x02 || (TCCR0B & 0x08) || prescaler[TCCR0B & 0x07] == 0){
+		return 0;
+	}
+	return (uint32_t) (OCR0A + 1) * prescaler[TCCR0B & 0x07] / CLOCK_CPU_MHZ;
+}
+
+static void simAvancar(uint64_t duracao){
+	/****************************************************************************************************************************
+	Avança o relógio virtual, executando a interrupção do temporizador 0 a cada período que passa durante o intervalo, ou
+	deixando-a pendente caso as interrupções estejam desabilitadas
+	****************************************************************************************************************************/
+	uint64_t alvo = sim.agora + duracao;
+
+	for (;;){
+		uint32_t periodo = periodoTimer0();
+		if (periodo == 0){
+			sim.proximoTick = 0;
+			break;
+		}
+		if (sim.proximoTick == 0){
+			sim.proximoTick = sim.agora + periodo;
+		}
+		if (sim.proximoTick > alvo){
+			break;
+		}
+
+		sim.agora = sim.proximoTick;
+		sim.proximoTick += periodo;
+		aplicarEventos();
+
+		if (TIMSK0 & 0x02){
+			if (sim.interrupcoes){
+				simInterrupcaoTimer0();
+			}
+			else {
+				sim.interrupcaoPendente = true;
+			}
+		}
+	}
+
+	sim.agora = alvo;
+	aplicarEventos();
+}
+
+void _delay_ms(double ms){
+	simAvancar((uint64_t) (ms * 1000));
+}
+
+void cli(){
+	sim.interrupcoes = false;
+}
+
+void sei(){
+	sim.interrupcoes = true;
+	if (sim.interrupcaoPendente){
+		sim.interrupcaoPendente = false;
+		simInterrupcaoTimer0();
+	}
+}
+
+bool simInterrupcoesHabilitadas(){
+	return sim.interrupcoes;
+}
+
+
+//GPIO E ADC
+
+uint8_t simLerPINC(){
+	/****************************************************************************************************************************
+	As colunas ficam em nível alto pelo pull-up, exceto a coluna da tecla pressionada quando a linha dela está configurada como
+	saída em nível baixo em PORTD. A posição da tecla é procurada na própria tabela 'teclado' do firmware
+	****************************************************************************************************************************/
+	aplicarEventos();
+
+	uint8_t valor = 0x3F;
+
+	if (sim.teclaPressionada == -1){
+		return valor;
+	}
+
+	for (uint8_t linha = 0; linha < 4; linha++){
+		for (uint8_t coluna = 0; coluna < 3; coluna++){
+			if ((char) pgm_read_byte(&teclado[linha][coluna]) != sim.teclaPressionada){
+				continue;
+			}
+
+			uint8_t bitLinha = Placa::Teclado::linha(linha);
+			uint8_t bitColuna = Placa::Teclado::coluna(coluna);
+
+			if ((DDRD & bitLinha) && !(PORTD & bitLinha) && !(DDRC & bitColuna)){
+				valor &= ~bitColuna;
+			}
+		}
+	}
+
+	return valor;
+}
+
+int analogRead(uint8_t pino){
+	simAvancar(CUSTO_CONVERSAO_ADC);
+
+	if (pino != A0){
+		return 0;
+	}
+
+	sim.amostras.push_back(sim.agora);
+	registrar("amostra A0=%d", sim.adc);
+
+	return sim.adc;
+}
+
+
+//SERIAL
+
+size_t Print::print(const __FlashStringHelper *texto){
+	const char *c = reinterpret_cast<const char *>(texto);
+	size_t n = 0;
+	while (pgm_read_byte(c)){
+		n += write(pgm_read_byte(c++));
+	}
+	return n;
+}
+
+size_t Print::print(const char *texto){
+	size_t n = 0;
+	while (*texto){
+		n += write(*texto++);
+	}
+	return n;
+}
+
+size_t Print::print(char c){
+	return write(c);
+}
+
+size_t Print::print(int n){
+	char texto[12];
+	snprintf(texto, sizeof texto, "%d", n);
+	return print(texto);
+}
+
+size_t Print::print(double n, int casas){
+	char texto[40];
+	snprintf(texto, sizeof texto, "%.*f", casas, n);
+	return print(texto);
+}
+
+size_t Print::println(){
+	return print("\r\n");
+}
+
+size_t Print::println(const char *texto){
+	return print(texto) + println();
+}
+
+size_t Print::println(int n){
+	return print(n) + println();
+}
+
+size_t Print::println(double n, int casas){
+	return print(n, casas) + println();
+}
+
+void HardwareSerial::begin(unsigned long /*baud*/){
+}
+
+int HardwareSerial::available(){
+	aplicarEventos();
+	return sim.bufferRX.size();
+}
+
+int HardwareSerial::read(){
+	aplicarEventos();
+	if (sim.bufferRX.empty()){
+		return -1;
+	}
+
+	uint8_t c = sim.bufferRX.front();
+	sim.bufferRX.pop_front();
+	return c;
+}
+
+size_t HardwareSerial::write(uint8_t c){
+	/****************************************************************************************************************************
+	Cada caractere entra na fila de transmissão com o instante em que termina de ser enviado. Com a fila cheia o firmware fica
+	bloqueado até que o caractere mais antigo termine de sair, como na biblioteca do Arduino
+	****************************************************************************************************************************/
+	while (!sim.filaTX.empty() && sim.filaTX.front() <= sim.agora){
+		sim.filaTX.pop_front();
+	}
+	if (sim.filaTX.size() >= TAMANHO_BUFFER_UART){
+		simAvancar(sim.filaTX.front() - sim.agora);
+		sim.filaTX.pop_front();
+	}
+
+	uint64_t inicio = sim.filaTX.empty() ? sim.agora : std::max(sim.agora, sim.filaTX.back());
+	sim.filaTX.push_back(inicio + CUSTO_CARACTERE_UART);
+
+	if (c == '\n'){
+		registrar("serial-tx \"%s\"", sim.linhaTX.c_str());
+		sim.linhasTX.push_back(sim.linhaTX);
+		sim.linhaTX.clear();
+	}
+	else if (c != '\r'){
+		sim.linhaTX += c;
+	}
+
+	return 1;
+}
+
+
+//I2C: EEPROM 24C16 E EXPANSOR PCF8574
+
+static void escreverExpansor(uint8_t valor){
+	/****************************************************************************************************************************
+	O nibble mais significativo indica qual display está habilitado (nível baixo) e o menos significativo o valor enviado ao
+	CD4511. Um quadro é registrado sempre que o último display da multiplexação é atualizado e o conteúdo mudou
+	****************************************************************************************************************************/
+	if (sim.ultimaEscritaExpansor != 0){
+		sim.maiorIntervaloExpansor = std::max(sim.maiorIntervaloExpansor, sim.agora - sim.ultimaEscritaExpansor);
+	}
+	sim.ultimaEscritaExpansor = sim.agora;
+
+	int display;
+	switch (valor >> 4){
+		case 0x07: display = 0; break;
+		case 0x0B: display = 1; break;
+		case 0x0D: display = 2; break;
+		case 0x0E: display = 3; break;
+		default: return;
+	}
+
+	sim.digitos7seg[display] = valor & 0x0F;
+	sim.digitoRecebido[display] = true;
+
+	if (display != 3 || !sim.digitoRecebido[0] || !sim.digitoRecebido[1] || !sim.digitoRecebido[2]){
+		return;
+	}
+
+	//O CD4511 apaga o display para valores acima de 9
+	char quadro[6];
+	const uint8_t *d = sim.digitos7seg;
+	snprintf(quadro, sizeof quadro, "%c%c.%c%c",
+		d[0] < 10 ? '0' + d[0] : ' ', d[1] < 10 ? '0' + d[1] : ' ',
+		d[2] < 10 ? '0' + d[2] : ' ', d[3] < 10 ? '0' + d[3] : ' ');
+
+	if (sim.quadro7seg != quadro){
+		sim.quadro7seg = quadro;
+		registrar("7seg %s", quadro);
+	}
+}
+
+static bool enderecoEEPROM(uint8_t endereco){
+	return (endereco & ~BITS_ENDERECO_EEPROM) == ENDERECO_EEPROM;
+}
+
+static uint8_t nack(uint8_t endereco, const char *motivo){
+	sim.nacks++;
+	registrar("i2c NACK 0x%02X: %s", endereco, motivo);
+	simAvancar(CUSTO_START_STOP_I2C);
+	return 2;
+}
+
+void TwoWire::begin(){
+}
+
+void TwoWire::beginTransmission(uint8_t endereco){
+	sim.enderecoI2C = endereco;
+	sim.transmissaoI2C.clear();
+}
+
+void TwoWire::beginTransmission(int endereco){
+	beginTransmission((uint8_t) endereco);
+}
+
+size_t TwoWire::write(uint8_t dado){
+	sim.transmissaoI2C.push_back(dado);
+	return 1;
+}
+
+size_t TwoWire::write(const uint8_t *dados, size_t quantidade){
+	for (size_t i = 0; i < quantidade; i++){
+		write(dados[i]);
+	}
+	return quantidade;
+}
+
+uint8_t TwoWire::endTransmission(uint8_t /*enviarStop*/){
+	//O repeated start não muda o tempo simulado de forma relevante, então toda transmissão termina com stop
+	return endTransmission();
+}
+
+uint8_t TwoWire::endTransmission(){
+	/****************************************************************************************************************************
+	A transmissão é entregue ao dispositivo somente ao final, como na biblioteca Wire. O byte de endereço é enviado antes, para
+	que a EEPROM possa recusar com NACK caso ainda esteja em seu ciclo interno de gravação
+	Na EEPROM o primeiro byte é o endereço da palavra e os demais são gravados com roll-over dentro da página de 16 bytes
+	****************************************************************************************************************************/
+	uint8_t endereco = sim.enderecoI2C;
+	const std::vector<uint8_t> &dados = sim.transmissaoI2C;
+
+	simAvancar(CUSTO_START_STOP_I2C + CUSTO_BYTE_I2C);
+
+	if (enderecoEEPROM(endereco)){
+		if (sim.agora < sim.eepromOcupadaAte){
+			return nack(endereco, "EEPROM em ciclo de gravacao");
+		}
+
+		simAvancar(dados.size() * CUSTO_BYTE_I2C + CUSTO_START_STOP_I2C);
+
+		if (dados.empty()){
+			return 0;
+		}
+
+		sim.ponteiroEEPROM = ((endereco & BITS_ENDERECO_EEPROM) << 8) | dados[0];
+
+		if (dados.size() > 1){
+			uint16_t pagina = sim.ponteiroEEPROM & ~(PAGINA_EEPROM - 1);
+			char texto[3 * PAGINA_EEPROM + 1] = "";
+
+			for (size_t i = 1; i < dados.size(); i++){
+				uint16_t posicao = pagina | ((sim.ponteiroEEPROM + i - 1) & (PAGINA_EEPROM - 1));
+				sim.eeprom[posicao] = dados[i];
+				if (i <= PAGINA_EEPROM){
+					snprintf(texto + 3 * (i - 1), 4, " %02X", dados[i]);
+				}
+			}
+
+			registrar("eeprom [0x%03X] <-%s", sim.ponteiroEEPROM, texto);
+			sim.eepromOcupadaAte = sim.agora + TEMPO_GRAVACAO_EEPROM;
+		}
+
+		return 0;
+	}
+
+	if (endereco == ENDERECO_EXPANSOR){
+		for (size_t i = 0; i < dados.size(); i++){
+			simAvancar(CUSTO_BYTE_I2C);
+			escreverExpansor(dados[i]);
+		}
+		simAvancar(CUSTO_START_STOP_I2C);
+		return 0;
+	}
+
+	return nack(endereco, "nenhum dispositivo");
+}
+
+uint8_t TwoWire::requestFrom(int endereco, int quantidade){
+	sim.recepcaoI2C.clear();
+
+	simAvancar(CUSTO_START_STOP_I2C + CUSTO_BYTE_I2C);
+
+	if (!enderecoEEPROM(endereco)){
+		nack(endereco, "nenhum dispositivo");
+		return 0;
+	}
+	if (sim.agora < sim.eepromOcupadaAte){
+		nack(endereco, "EEPROM em ciclo de gravacao");
+		return 0;
+	}
+
+	simAvancar(quantidade * CUSTO_BYTE_I2C + CUSTO_START_STOP_I2C);
+
+	for (int i = 0; i < quantidade; i++){
+		sim.recepcaoI2C.push_back(sim.eeprom[sim.ponteiroEEPROM]);
+		sim.ponteiroEEPROM = (sim.ponteiroEEPROM + 1) % TAMANHO_EEPROM;
+	}
+
+	return quantidade;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t endereco, uint8_t quantidade){
+	return requestFrom((int) endereco, (int) quantidade);
+}
+
+uint8_t TwoWire::requestFrom(uint8_t endereco, uint8_t quantidade, uint8_t /*enviarStop*/){
+	return requestFrom((int) endereco, (int) quantidade);
+}
+
+uint8_t TwoWire::requestFrom(int endereco, int quantidade, int /*enviarStop*/){
+	return requestFrom(endereco, quantidade);
+}
+
+int TwoWire::available(){
+	return sim.recepcaoI2C.size();
+}
+
+int TwoWire::read(){
+	if (sim.recepcaoI2C.empty()){
+		return -1;
+	}
+
+	uint8_t dado = sim.recepcaoI2C.front();
+	sim.recepcaoI2C.pop_front();
+	return dado;
+}
+
+
+//DISPLAY LCD
+
+LiquidCrystal::LiquidCrystal(uint8_t /*rs*/, uint8_t /*enable*/, uint8_t /*d4*/, uint8_t /*d5*/, uint8_t /*d6*/,
+	uint8_t /*d7*/){
+}
+
+void LiquidCrystal::begin(uint8_t /*colunas*/, uint8_t /*linhas*/){
+	simAvancar(CUSTO_INICIAR_LCD);
+	clear();
+}
+
+void LiquidCrystal::clear(){
+	simAvancar(CUSTO_COMANDO_LCD + CUSTO_LIMPAR_LCD);
+
+	memset(sim.lcd, ' ', sizeof sim.lcd);
+	sim.lcd[0][16] = sim.lcd[1][16] = '\0';
+	sim.colunaLCD = 0;
+	sim.linhaLCD = 0;
+	sim.lcdAlterado = true;
+}
+
+void LiquidCrystal::setCursor(uint8_t coluna, uint8_t linha){
+	simAvancar(CUSTO_COMANDO_LCD);
+
+	sim.colunaLCD = coluna;
+	sim.linhaLCD = linha & 0x01;
+}
+
+size_t LiquidCrystal::write(uint8_t c){
+	simAvancar(CUSTO_COMANDO_LCD);
+
+	//A memória do HD44780 continua além da coluna 16, mas esses caracteres não aparecem
+	if (sim.colunaLCD < 16){
+		sim.lcd[sim.linhaLCD][sim.colunaLCD] = c;
+		sim.lcdAlterado = true;
+	}
+	sim.colunaLCD++;
+
+	return 1;
+}
+
+
+//EXECUÇÃO
+
+static void prepararSimulacao(const std::vector<Evento> &eventos, bool ecoar){
+	/****************************************************************************************************************************
+	Coloca o hardware virtual no estado de uma placa recém ligada, com a EEPROM apagada (0xFF). Entre esta função e ligar() a
+	imagem da EEPROM pode ser alterada
+	****************************************************************************************************************************/
+	sim = Simulacao();
+	sim.eventos = eventos;
+	std::stable_sort(sim.eventos.begin(), sim.eventos.end(),
+		[](const Evento &a, const Evento &b){ return a.tempo < b.tempo; });
+
+	sim.teclaPressionada = -1;
+	sim.interrupcoes = true;
+	sim.ecoar = ecoar;
+	memset(sim.eeprom, 0xFF, sizeof sim.eeprom);
+	memset(sim.lcd, ' ', sizeof sim.lcd);
+	sim.lcd[0][16] = sim.lcd[1][16] = '\0';
+
+	DDRC = PORTC = DDRD = PORTD = 0;
+	TCCR0A = TCCR0B = OCR0A = TIMSK0 = 0;
+}
+
+static void ligar(){
+	aplicarEventos();
+	setup();
+	registrarLCD();
+}
+
+static void executarAte(uint64_t fim, void (*aoFimDoLoop)() = NULL){
+	while (sim.agora < fim){
+		uint64_t inicio = sim.agora;
+
+		loop();
+		simAvancar(CUSTO_LOOP);
+
+		sim.maiorLoop = std::max(sim.maiorLoop, sim.agora - inicio);
+		registrarLCD();
+
+		if (aoFimDoLoop){
+			aoFimDoLoop();
+		}
+	}
+}
+
+static uint16_t lerPar(uint16_t posicao){
+	return (sim.eeprom[posicao] << 8) | sim.eeprom[posicao + 1];
+}
+
+static void gravarPar(uint16_t posicao, uint16_t valor){
+	sim.eeprom[posicao] = valor >> 8;
+	sim.eeprom[posicao + 1] = valor & 0xFF;
+}
+
+static std::string linhaLCD(int linha){
+	std::string texto = sim.lcd[linha];
+	texto.erase(texto.find_last_not_of(' ') + 1);
+	return texto;
+}
+
+
+//MODO TRAÇO
+
+static bool lerTraco(const char *arquivo, std::vector<Evento> &eventos, uint64_t &fim){
+	FILE *entrada = fopen(arquivo, "r");
+	if (!entrada){
+		fprintf(stderr, "%s: nao foi possivel abrir\n", arquivo);
+		return false;
+	}
+
+	char linha[512];
+	int numero = 0;
+	bool ok = true;
+
+	while (ok && fgets(linha, sizeof linha, entrada)){
+		numero++;
+		linha[strcspn(linha, "\r\n")] = '\0';
+
+		char *texto = linha + strspn(linha, " \t");
+		if (*texto == '\0' || *texto == '#'){
+			continue;
+		}
+
+		double ms;
+		char comando[16];
+		int lidos;
+		if (sscanf(texto, "%lf %15s %n", &ms, comando, &lidos) < 2 || ms < 0){
+			fprintf(stderr, "%s:%d: evento invalido\n", arquivo, numero);
+			ok = false;
+			break;
+		}
+
+		Evento evento;
+		evento.tempo = (uint64_t) (ms * 1000);
+		evento.valor = 0;
+		const char *argumento = texto + lidos;
+
+		if (strcmp(comando, "adc") == 0 && sscanf(argumento, "%d", &evento.valor) == 1
+				&& evento.valor >= 0 && evento.valor <= 1023){
+			evento.tipo = 'a';
+		}
+		else if (strcmp(comando, "pressiona") == 0 && *argumento != '\0'){
+			evento.tipo = 'p';
+			evento.valor = *argumento;
+		}
+		else if (strcmp(comando, "solta") == 0){
+			evento.tipo = 's';
+		}
+		else if (strcmp(comando, "serial") == 0){
+			evento.tipo = 'r';
+			evento.texto = std::string(argumento) + "\n";
+		}
+		else if (strcmp(comando, "fim") == 0){
+			fim = evento.tempo;
+			continue;
+		}
+		else {
+			fprintf(stderr, "%s:%d: evento invalido\n", arquivo, numero);
+			ok = false;
+			break;
+		}
+
+		eventos.push_back(evento);
+	}
+
+	fclose(entrada);
+	return ok;
+}
+
+static void relatorio(){
+	printf("\nResumo\n");
+	printf("  amostras: %u\n", (unsigned) sim.amostras.size());
+
+	if (sim.amostras.size() > 2){
+		uint64_t menor = UINT64_MAX, maior = 0;
+		for (size_t i = 2; i < sim.amostras.size(); i++){
+			uint64_t intervalo = sim.amostras[i] - sim.amostras[i - 1];
+			menor = std::min(menor, intervalo);
+			maior = std::max(maior, intervalo);
+		}
+		printf("  intervalo entre amostras: %.3f a %.3f ms\n", menor / 1000.0, maior / 1000.0);
+	}
+
+	printf("  maior loop: %.3f ms\n", sim.maiorLoop / 1000.0);
+	printf("  maior intervalo entre escritas no expansor: %.3f ms\n", sim.maiorIntervaloExpansor / 1000.0);
+	printf("  NACKs no I2C: %u\n", sim.nacks);
+	printf("  caracteres perdidos na recepcao serial: %u\n", sim.perdidosRX);
+
+	uint16_t quantidade = lerPar(ENDERECO_QUANTIDADE);
+	printf("\nEEPROM: %u medidas gravadas\n", quantidade);
+
+	for (uint16_t i = 0; i < quantidade && i < CAPACIDADE_EEPROM; i++){
+		printf("  %4u: %.2f\n", i, lerPar(Placa::Memoria::enderecoMedida(i)) / 100.0);
+	}
+}
+
+static bool carregarImagem(const char *arquivo){
+	FILE *entrada = fopen(arquivo, "rb");
+	if (!entrada){
+		fprintf(stderr, "%s: nao foi possivel abrir\n", arquivo);
+		return false;
+	}
+
+	size_t lidos = fread(sim.eeprom, 1, sizeof sim.eeprom, entrada);
+	fclose(entrada);
+
+	if (lidos != sizeof sim.eeprom){
+		fprintf(stderr, "%s: a imagem deve ter %d bytes\n", arquivo, TAMANHO_EEPROM);
+		return false;
+	}
+	return true;
+}
+
+static bool salvarImagem(const char *arquivo){
+	FILE *saida = fopen(arquivo, "wb");
+	if (!saida || fwrite(sim.eeprom, 1, sizeof sim.eeprom, saida) != sizeof sim.eeprom){
+		fprintf(stderr, "%s: nao foi possivel gravar\n", arquivo);
+		if (saida){
+			fclose(saida);
+		}
+		return false;
+	}
+	fclose(saida);
+	return true;
+}
+
+
+//MODO AUTOTESTE
+
+static int falhas;
+static const char *cenarioAtual;
+
+static void verificar(bool condicao, const char *formato, ...){
+	if (condicao){
+		return;
+	}
+
+	falhas++;
+	fprintf(stderr, "FALHA [%s] ", cenarioAtual);
+
+	va_list argumentos;
+	va_start(argumentos, formato);
+	vfprintf(stderr, formato, argumentos);
+	va_end(argumentos);
+
+	fputc('\n', stderr);
+}
+
+static void teclar(std::vector<Evento> &eventos, double ms, char tecla, double duracao = 100){
+	Evento pressiona = {(uint64_t) (ms * 1000), 'p', tecla, ""};
+	Evento solta = {(uint64_t) ((ms + duracao) * 1000), 's', 0, ""};
+	eventos.push_back(pressiona);
+	eventos.push_back(solta);
+}
+
+static void verificarTemporizacao(){
+	verificar(sim.nacks == 0, "%u NACKs no I2C", sim.nacks);
+	verificar(sim.maiorIntervaloExpansor <= LIMITE_INTERVALO_7SEG_MS * 1000ULL,
+		"displays de 7 segmentos sem atualizacao por %.3f ms", sim.maiorIntervaloExpansor / 1000.0);
+}
+
+static void cenarioColeta(){
+	/****************************************************************************************************************************
+	Coleta de 10 períodos de amostragem: as amostras devem sair a cada período, sem acumular atraso, e cada amostra feita durante
+	a coleta deve estar gravada na EEPROM com a quantidade correta no par reservado para ela
+	****************************************************************************************************************************/
+	cenarioAtual = "coleta";
+
+	std::vector<Evento> eventos;
+	Evento adc = {0, 'a', 52, ""};
+	eventos.push_back(adc);
+	teclar(eventos, 200, '3');
+	teclar(eventos, 500, '#');
+	double fimColeta = 500 + 10 * PERIODO_AMOSTRAGEM_MS;
+	teclar(eventos, fimColeta, '4');
+	teclar(eventos, fimColeta + 300, '#');
+
+	prepararSimulacao(eventos, false);
+	gravarPar(ENDERECO_QUANTIDADE, 0);
+	ligar();
+	executarAte((fimColeta + 1500) * 1000);
+
+	for (size_t i = 2; i < sim.amostras.size(); i++){
+		int64_t intervalo = sim.amostras[i] - sim.amostras[i - 1];
+		verificar(llabs(intervalo - PERIODO_AMOSTRAGEM_MS * 1000LL) <= TOLERANCIA_AMOSTRAGEM_MS * 1000LL,
+			"intervalo de %.3f ms entre as amostras %u e %u", intervalo / 1000.0, (unsigned) i - 1, (unsigned) i);
+	}
+
+	unsigned esperadas = 0;
+	for (size_t i = 0; i < sim.amostras.size(); i++){
+		if (sim.amostras[i] > 700000 && sim.amostras[i] < (fimColeta + 100) * 1000){
+			esperadas++;
+		}
+	}
+
+	float temperaturaEsperada = 52 * 48.8759;
+	uint16_t quantidade = lerPar(ENDERECO_QUANTIDADE);
+
+	verificar(esperadas >= 9, "somente %u amostras durante a coleta", esperadas);
+	verificar(quantidade == esperadas, "%u medidas gravadas, esperado %u", quantidade, esperadas);
+	verificar(quantidade == quantOcupada, "quantOcupada = %d, EEPROM = %u", quantOcupada, quantidade);
+	for (uint16_t i = 0; i < quantidade && i < CAPACIDADE_EEPROM; i++){
+		verificar(lerPar(Placa::Memoria::enderecoMedida(i)) == (uint16_t) (int) temperaturaEsperada, "medida %u = %u", i,
+			lerPar(Placa::Memoria::enderecoMedida(i)));
+	}
+	verificar(!estado.coletando, "coleta nao foi finalizada");
+	verificar(linhaLCD(0) == "Fim da coleta!", "LCD \"%s\"", linhaLCD(0).c_str());
+	verificarTemporizacao();
+}
+
+static void cenarioTransferencia(){
+	/****************************************************************************************************************************
+	Pedido de 10 medidas com somente 5 gravadas: devem ser enviadas as 5, em ordem, com aviso no LCD
+	****************************************************************************************************************************/
+	cenarioAtual = "transferencia";
+
+	static const uint16_t valores[5] = {2534, 1000, 0, 4999, 3120};
+	static const char *esperado[5] = {"25.34", "10.00", "0.00", "49.99", "31.20"};
+
+	std::vector<Evento> eventos;
+	teclar(eventos, 200, '5');
+	teclar(eventos, 500, '#');
+	teclar(eventos, 800, '1');
+	teclar(eventos, 1100, '0');
+	teclar(eventos, 1400, '#');
+
+	prepararSimulacao(eventos, false);
+	for (int i = 0; i < 5; i++){
+		gravarPar(Placa::Memoria::enderecoMedida(i), valores[i]);
+	}
+	gravarPar(ENDERECO_QUANTIDADE, 5);
+	ligar();
+	executarAte(3000000);
+
+	verificar(sim.linhasTX.size() == 5, "%u linhas enviadas, esperado 5", (unsigned) sim.linhasTX.size());
+	for (size_t i = 0; i < sim.linhasTX.size() && i < 5; i++){
+		verificar(sim.linhasTX[i] == esperado[i], "linha %u = \"%s\", esperado \"%s\"", (unsigned) i,
+			sim.linhasTX[i].c_str(), esperado[i]);
+	}
+	verificar(linhaLCD(0) == "Qnt > gravado" && linhaLCD(1) == "Imprimindo: 5", "LCD \"%s\" \"%s\"",
+		linhaLCD(0).c_str(), linhaLCD(1).c_str());
+	verificar(estado.funcao == semFuncao, "funcao = %d apos a transferencia", estado.funcao);
+	verificarTemporizacao();
+}
+
+static void cenarioApagar(){
+	cenarioAtual = "apagar";
+
+	std::vector<Evento> eventos;
+	teclar(eventos, 200, '1');
+	teclar(eventos, 500, '#');
+
+	prepararSimulacao(eventos, false);
+	gravarPar(ENDERECO_QUANTIDADE, 37);
+	ligar();
+	executarAte(1500000);
+
+	verificar(lerPar(ENDERECO_QUANTIDADE) == 0, "quantidade na EEPROM = %u", lerPar(ENDERECO_QUANTIDADE));
+	verificar(quantOcupada == 0, "quantOcupada = %d", quantOcupada);
+	char disponivel[17];
+	snprintf(disponivel, sizeof disponivel, "Disponivel: %d", CAPACIDADE_EEPROM);
+	verificar(linhaLCD(0) == "Memoria Apagada!" && linhaLCD(1) == disponivel, "LCD \"%s\" \"%s\"",
+		linhaLCD(0).c_str(), linhaLCD(1).c_str());
+	verificarTemporizacao();
+}
+
+static void cenarioParQuantidade(){
+	/****************************************************************************************************************************
+	Coleta começando na medida anterior ao par da quantidade: as medidas seguintes devem pular esse par, sem que a quantidade
+	sobrescreva uma medida ou uma medida sobrescreva a quantidade
+	****************************************************************************************************************************/
+	cenarioAtual = "par da quantidade";
+
+	std::vector<Evento> eventos;
+	Evento adc = {0, 'a', 70, ""};
+	eventos.push_back(adc);
+	teclar(eventos, 200, '3');
+	teclar(eventos, 500, '#');
+	double fimColeta = 500 + 3.5 * PERIODO_AMOSTRAGEM_MS;
+	teclar(eventos, fimColeta, '4');
+	teclar(eventos, fimColeta + 300, '#');
+
+	uint16_t inicio = ENDERECO_QUANTIDADE / 2 - 1;
+	prepararSimulacao(eventos, false);
+	gravarPar(ENDERECO_QUANTIDADE, inicio);
+	ligar();
+	executarAte((fimColeta + 1500) * 1000);
+
+	float temperaturaEsperada = 70 * 48.8759;
+	uint16_t quantidade = lerPar(ENDERECO_QUANTIDADE);
+
+	verificar(quantidade >= inicio + 2 || quantidade == CAPACIDADE_EEPROM, "quantidade na EEPROM = %u", quantidade);
+	for (uint16_t i = inicio; i < quantidade && i < CAPACIDADE_EEPROM; i++){
+		verificar(lerPar(Placa::Memoria::enderecoMedida(i)) == (uint16_t) (int) temperaturaEsperada, "medida %u = %u", i,
+			lerPar(Placa::Memoria::enderecoMedida(i)));
+	}
+	verificarTemporizacao();
+}
+
+static void cenarioMemoriaCheia(){
+	cenarioAtual = "memoria cheia";
+
+	std::vector<Evento> eventos;
+	Evento adc = {0, 'a', 61, ""};
+	eventos.push_back(adc);
+	teclar(eventos, 200, '3');
+	teclar(eventos, 500, '#');
+
+	prepararSimulacao(eventos, false);
+	gravarPar(ENDERECO_QUANTIDADE, CAPACIDADE_EEPROM - 2);
+	ligar();
+	executarAte((500 + 4 * PERIODO_AMOSTRAGEM_MS) * 1000);
+
+	verificar(lerPar(ENDERECO_QUANTIDADE) == CAPACIDADE_EEPROM, "quantidade na EEPROM = %u", lerPar(ENDERECO_QUANTIDADE));
+	verificar(!estado.coletando, "coleta continua com a memoria cheia");
+	verificar(linhaLCD(0) == "Memoria Cheia" && linhaLCD(1) == "Coleta Terminada", "LCD \"%s\" \"%s\"",
+		linhaLCD(0).c_str(), linhaLCD(1).c_str());
+	verificarTemporizacao();
+}
+
+
+/********************************************************************************************************************************
+Rodadas aleatórias do teclado
+
+Cada rodada gera um minuto de pressionamentos com duração e intervalo aleatórios, incluindo valores abaixo do tempo de um loop.
+A cada loop, quando o firmware reconhece uma nova tecla (teclaReconhecida passa de 0 para 1), a mesma tecla é aplicada ao modelo
+de referência abaixo e o estado do modelo é comparado com 'funcao', 'coletando' e 'impressao' do firmware.
+Pressionamentos de pelo menos DURACAO_MINIMA_TECLA_MS, precedidos de um intervalo também desse tamanho, devem ser reconhecidos
+exatamente uma vez. Nenhum pressionamento pode ser reconhecido mais de uma vez.
+********************************************************************************************************************************/
+
+struct Modelo {
+	funcoes funcao;
+	bool coletando;
+	int impressao;
+	int digitos;
+
+	void tecla(char t, int quantidade){
+		if (funcao == escolherValores && digitos < 4 && t != '#'){
+			impressao = impressao * 10 + t - '0';
+			digitos++;
+		}
+
+		if (funcao == semFuncao){
+			switch (t){
+				case '1': funcao = reset; break;
+				case '2': funcao = status; break;
+				case '3': funcao = start; break;
+				case '4': funcao = stop; break;
+				case '5': funcao = transferir; break;
+			}
+		}
+		else if (t == '#'){
+			switch (funcao){
+				case start:
+					coletando = coletando || quantidade < CAPACIDADE_EEPROM;
+					funcao = semFuncao;
+					break;
+				case stop:
+					coletando = false;
+					funcao = semFuncao;
+					break;
+				case transferir:
+					funcao = escolherValores;
+					break;
+				case escolherValores:
+					impressao = std::min(impressao, quantidade);
+					digitos = 0;
+					funcao = enviarValores;
+					break;
+				case enviarValores:
+					break;
+				default:
+					funcao = semFuncao;
+					break;
+			}
+		}
+		else if (t == '*'){
+			funcao = semFuncao;
+			impressao = 0;
+			digitos = 0;
+		}
+	}
+};
+
+struct Pressionamento {
+	char tecla;
+	uint64_t duracao;
+	uint64_t intervaloAntes;
+	int reconhecimentos;
+};
+
+static Modelo modelo;
+static std::vector<Pressionamento> pressionamentos;
+static bool teclaReconhecidaAntes;
+static bool divergiu;
+
+static uint32_t sorteio(uint32_t &gerador){
+	//xorshift32, para que a mesma semente gere a mesma rodada em qualquer máquina
+	gerador ^= gerador << 13;
+	gerador ^= gerador >> 17;
+	gerador ^= gerador << 5;
+	return gerador;
+}
+
+static void observarTeclado(){
+	if (estado.teclaReconhecida && !teclaReconhecidaAntes && sim.pressionamentos > 0){
+		Pressionamento &p = pressionamentos[sim.pressionamentos - 1];
+		p.reconhecimentos++;
+		modelo.tecla(p.tecla, quantOcupada);
+	}
+	teclaReconhecidaAntes = estado.teclaReconhecida;
+
+	//O fim da transmissão pela serial não depende do teclado
+	if (modelo.funcao == enviarValores && estado.funcao == semFuncao){
+		modelo.funcao = semFuncao;
+		modelo.impressao = 0;
+	}
+
+	if (!divergiu && (modelo.funcao != estado.funcao || modelo.coletando != (bool) estado.coletando
+			|| modelo.impressao != impressao)){
+		divergiu = true;
+		verificar(false, "em %.3f ms: firmware funcao=%d coletando=%d impressao=%d, modelo funcao=%d coletando=%d "
+			"impressao=%d", sim.agora / 1000.0, estado.funcao, estado.coletando, impressao, modelo.funcao,
+			modelo.coletando, modelo.impressao);
+	}
+}
+
+static void rodadaTeclado(uint32_t semente){
+	static const char teclas[] = "123451234#####*****0123456789";
+	static char nome[40];
+	snprintf(nome, sizeof nome, "teclado, semente %u", semente);
+	cenarioAtual = nome;
+
+	uint32_t gerador = semente ? semente : 1;
+	std::vector<Evento> eventos;
+	pressionamentos.clear();
+
+	uint64_t t = 300000;
+	uint64_t intervalo = t;
+	while (t < 60000000){
+		if (sorteio(gerador) % 8 == 0){
+			Evento adc = {t, 'a', (int) (sorteio(gerador) % 1024), ""};
+			eventos.push_back(adc);
+		}
+
+		Pressionamento p;
+		p.tecla = teclas[sorteio(gerador) % (sizeof teclas - 1)];
+		p.duracao = 5000 + sorteio(gerador) % 200000;
+		p.intervaloAntes = intervalo;
+		p.reconhecimentos = 0;
+		pressionamentos.push_back(p);
+
+		Evento pressiona = {t, 'p', p.tecla, ""};
+		Evento solta = {t + p.duracao, 's', 0, ""};
+		eventos.push_back(pressiona);
+		eventos.push_back(solta);
+
+		intervalo = 5000 + sorteio(gerador) % 400000;
+		t += p.duracao + intervalo;
+	}
+
+	prepararSimulacao(eventos, false);
+	gravarPar(ENDERECO_QUANTIDADE, 0);
+	ligar();
+
+	modelo = Modelo();
+	modelo.funcao = semFuncao;
+	teclaReconhecidaAntes = estado.teclaReconhecida;
+	divergiu = false;
+
+	executarAte(t + 5000000, observarTeclado);
+
+	unsigned perdidos = 0;
+	for (size_t i = 0; i < pressionamentos.size(); i++){
+		const Pressionamento &p = pressionamentos[i];
+		bool garantido = p.duracao >= DURACAO_MINIMA_TECLA_MS * 1000 && p.intervaloAntes >= DURACAO_MINIMA_TECLA_MS * 1000;
+
+		verificar(p.reconhecimentos <= 1, "tecla %u ('%c') reconhecida %d vezes", (unsigned) i, p.tecla,
+			p.reconhecimentos);
+		if (garantido && p.reconhecimentos == 0){
+			perdidos++;
+		}
+	}
+	verificar(perdidos == 0, "%u teclas de pelo menos %d ms perdidas", perdidos, DURACAO_MINIMA_TECLA_MS);
+	verificarTemporizacao();
+}
+
+static int autoteste(int rodadas, uint32_t semente){
+	falhas = 0;
+
+	cenarioColeta();
+	cenarioTransferencia();
+	cenarioApagar();
+	cenarioMemoriaCheia();
+	cenarioParQuantidade();
+
+	for (int i = 0; i < rodadas; i++){
+		rodadaTeclado(semente + i);
+	}
+
+	if (falhas){
+		fprintf(stderr, "%d falhas\n", falhas);
+		return 1;
+	}
+
+	printf("autoteste: 5 cenarios e %d rodadas do teclado sem falhas\n", rodadas);
+	return 0;
+}
+
+
+int main(int argc, char **argv){
+	const char *traco = NULL;
+	const char *imagem = NULL;
+	const char *saidaImagem = NULL;
+	double duracao = -1;
+	bool modoAutoteste = false;
+	int rodadas = 20;
+	uint32_t semente = 1;
+
+	for (int i = 1; i < argc; i++){
+		if (strcmp(argv[i], "--autoteste") == 0){
+			modoAutoteste = true;
+		}
+		else if (strcmp(argv[i], "--rodadas") == 0 && i + 1 < argc){
+			rodadas = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--semente") == 0 && i + 1 < argc){
+			semente = strtoul(argv[++i], NULL, 10);
+		}
+		else if (strcmp(argv[i], "--eeprom") == 0 && i + 1 < argc){
+			imagem = argv[++i];
+		}
+		else if (strcmp(argv[i], "--salvar-eeprom") == 0 && i + 1 < argc){
+			saidaImagem = argv[++i];
+		}
+		else if (strcmp(argv[i], "--duracao") == 0 && i + 1 < argc){
+			duracao = atof(argv[++i]);
+		}
+		else if (argv[i][0] != '-' && !traco){
+			traco = argv[i];
+		}
+		else {
+			traco = NULL;
+			modoAutoteste = false;
+			break;
+		}
+	}
+
+	if (modoAutoteste){
+		return autoteste(rodadas, semente);
+	}
+
+	if (!traco){
+		fprintf(stderr, "uso: %s <traco> [--eeprom <imagem>] [--salvar-eeprom <imagem>] [--duracao <ms>]\n", argv[0]);
+		fprintf(stderr, "     %s --autoteste [--rodadas <n>] [--semente <n>]\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<Evento> eventos;
+	uint64_t fim = 0;
+	if (!lerTraco(traco, eventos, fim)){
+		return 2;
+	}
+	if (duracao >= 0){
+		fim = (uint64_t) (duracao * 1000);
+	}
+	else if (fim == 0){
+		for (size_t i = 0; i < eventos.size(); i++){
+			fim = std::max(fim, eventos[i].tempo);
+		}
+		fim += 3000000;
+	}
+
+	prepararSimulacao(eventos, true);
+	if (imagem && !carregarImagem(imagem)){
+		return 2;
+	}
+
+	ligar();
+	executarAte(fim);
+	relatorio();
+
+	if (saidaImagem && !salvarImagem(saidaImagem)){
+		return 2;
+	}
+
+	return sim.nacks ? 1 : 0;
+}
@@ -0,0 +1,38 @@
+/********************************************************************************************************************************
+Substituto de <util/atomic.h> da avr-libc para o simulador
+
+ATOMIC_BLOCK desabilita as interrupções durante o bloco e, ao sair dele, as reabilita (ATOMIC_FORCEON) ou volta ao estado
+anterior (ATOMIC_RESTORESTATE), como na avr-libc. Uma interrupção do temporizador que ocorra durante o bloco fica pendente
+até o sei() do final
+********************************************************************************************************************************/
+
+#ifndef SIMULADOR_UTIL_ATOMIC_H
+#define SIMULADOR_UTIL_ATOMIC_H
+
+#include "../Arduino.h"
+
+#define ATOMIC_RESTORESTATE	true
+#define ATOMIC_FORCEON		false
+
+bool simInterrupcoesHabilitadas();
+
+struct SimBlocoAtomico {
+	bool habilitadasAntes;
+	bool restaurar;
+	bool executar;
+
+	SimBlocoAtomico(bool restaurarEstado) : habilitadasAntes(simInterrupcoesHabilitadas()), restaurar(restaurarEstado),
+		executar(true){
+		cli();
+	}
+
+	~SimBlocoAtomico(){
+		if (habilitadasAntes || !restaurar){
+			sei();
+		}
+	}
+};
+
+#define ATOMIC_BLOCK(tipo) for (SimBlocoAtomico simBloco(tipo); simBloco.executar; simBloco.executar = false)
+
+#endif